@@ -51,6 +51,10 @@ typedef VECTOR				MATRIX[FRAME_DIMENSIONS] ;
 #define	MATRIX_ROWS			(sizeof(MATRIX)/sizeof(VECTOR))
 #define	MATRIX_COLS			(sizeof(VECTOR)/sizeof(float))
 
+#if FRAME_DIMENSIONS != 3
+#error "VxV and MxV are unrolled for three dimensions"
+#endif
+
 typedef struct
 	{
 	float 					x ;
@@ -62,7 +66,29 @@ typedef struct
 
 typedef struct
 	{
-	VERTEX *				vertices[VERTICES] ;
+	float					w ;			// Unit quaternion; the
+	float					x ;			// cube's orientation
+	float					y ;
+	float					z ;
+	} QUATERNION ;
+
+typedef uint32_t			ANGLE ;		// 2^32 units per revolution
+
+typedef struct
+	{
+	VECTOR					position ;	// center, in model units
+	float					scale ;		// model units per cube half-edge
+	float					radius ;	// bounding sphere, in model units
+	QUATERNION				orientation ;
+	} INSTANCE ;
+
+#define	AXIS_X				0
+#define	AXIS_Y				1
+#define	AXIS_Z				2
+
+typedef struct
+	{
+	uint8_t					vertices[VERTICES] ;	// indices into model[]
 	CLR_INDEX				clr_index ;
 	} TRIANGLE ;
 
@@ -90,6 +116,18 @@ typedef struct
 	uint32_t				AMTCR ;		// AHB master timer configuration register
 	} CHROM_ART ;
 
+#define	DMA2D_MODE_M2M		0			// CR bits 17:16 - memory-to-memory,
+#define	DMA2D_MODE_PFC		1			// with pixel format conversion,
+#define	DMA2D_MODE_BLEND	2			// with blending, or
+#define	DMA2D_MODE_R2M		3			// register-to-memory (fill)
+
+#define	DMA2D_CM_ARGB8888	0			// xxPFCCR bits 3:0 - color mode
+#define	DMA2D_CM_RGB565		2
+#define	DMA2D_CM_L8			5
+#define	DMA2D_CM_L4			8
+
+#define	CLUT_ENTRIES		256
+
 typedef struct
 	{
 	const char *			name ;
@@ -103,6 +141,34 @@ typedef struct
 	uint32_t				xpos ;
 	} SLIDER ;
 
+typedef struct
+	{
+	int						xmin ;		// Inclusive bounds in frame
+	int						ymin ;		// coordinates; empty when
+	int						xmax ;		// xmin > xmax.
+	int						ymax ;
+	} RECT ;
+
+typedef struct
+	{
+	uint32_t				frames ;	// frames since last display
+	uint32_t				render ;	// cycles spent drawing the back buffer
+	uint32_t				stall ;		// cycles spent waiting on the DMA2D
+	uint32_t				xfer ;		// cycles for a full-frame transfer, not overlapped
+	} TIMING ;
+
+typedef struct
+	{
+	uint32_t				frames ;
+	uint32_t				culled ;	// instances rejected, all frames
+	uint64_t				total ;		// cycles for all frames; 32 bits
+	uint64_t				clear ;		// would wrap after 25.6 s
+	uint64_t				transform ;	// cycles per stage, summed
+	uint64_t				cull ;		// over all frames
+	uint64_t				paint ;
+	uint64_t				xfer ;
+	} BENCHMARK ;
+
 #define	FONT_WIDTH			7
 #define	FONT_HEIGHT			12
 
@@ -129,11 +195,27 @@ typedef struct
 extern sFONT				Font8, Font12, Font16, Font20, Font24 ;
 
 #define	PI					3.14159
+#define	RADIANS(a)			((ANGLE) ((a) / (2*PI) * 4294967296.0))
+
+#define	TRIG_BITS			10			// 1024 table entries per revolution
+#define	TRIG_STEPS			(1 << TRIG_BITS)
+#define	TRIG_FRAC			(32 - TRIG_BITS)
 #define	ENTRIES(a)			(sizeof(a)/sizeof(a[0]))
 
 #define	FRAME_ROWS			240
 #define	FRAME_COLS			240
-typedef CLR_INDEX			FRAME[FRAME_ROWS][FRAME_COLS] ;
+
+#define	FRAME_L4			1	// non-zero: two pixels per byte, low nibble first
+#if FRAME_L4
+#define	FRAME_BYTES			(FRAME_COLS/2)
+#define	FRAME_FILL(index)	(0x11 * (index))
+#define	FRAME_CM			DMA2D_CM_L4
+#else
+#define	FRAME_BYTES			FRAME_COLS
+#define	FRAME_FILL(index)	(index)
+#define	FRAME_CM			DMA2D_CM_L8
+#endif
+typedef uint8_t				FRAME[FRAME_ROWS][FRAME_BYTES] ;
 
 #define	X_CENTER			(FRAME_COLS/2)
 #define	Y_CENTER			(FRAME_ROWS/2)
@@ -141,6 +223,29 @@ typedef CLR_INDEX			FRAME[FRAME_ROWS][FRAME_COLS] ;
 #define	DISPLAY_XOFF		0
 #define	DISPLAY_YOFF		48
 
+#define	XFER_ROWS			(FRAME_ROWS - 20)	// rows visible above the slider
+
+#define	FRAME_BUFFERS		2	// ping-pong: render one while DMA2D sends the other
+
+#define	CHROM_ART_EMULATION	0	// non-zero: do DMA2D transfers in software
+#define	BENCHMARK_FRAMES	0	// non-zero: render this many frames headless and report
+#define	SWEEP_FRAMES		0	// non-zero: benchmark each scene size for this many frames
+#define	BENCH_ROW(n)		(DISPLAY_YOFF + (n)*FONT_HEIGHT)
+
+#define	SCENE_INSTANCES		1	// cubes drawn in interactive mode
+#define	MAX_INSTANCES		500
+#define	CUBE_RADIUS			1.7320508	// sqrt(3): corner of a unit half-edge cube
+
+// Visible part of the frame, in model units
+#define	MODEL_XMIN			(-X_CENTER / SIZE)
+#define	MODEL_XMAX			((FRAME_COLS - X_CENTER) / SIZE)
+#define	MODEL_YMIN			(-Y_CENTER / SIZE)
+#define	MODEL_YMAX			((XFER_ROWS - Y_CENTER) / SIZE)
+
+#define	TIMING_FRAMES		32	// frames averaged per timing display
+#define	TIMING_XPOS			5
+#define	TIMING_YPOS			(DISPLAY_YOFF - 2*FONT_HEIGHT - 4)
+
 #define	X_LEFT				-1.0
 #define	X_RIGHT				+1.0
 
@@ -163,80 +268,144 @@ typedef CLR_INDEX			FRAME[FRAME_ROWS][FRAME_COLS] ;
 #define	CPU_CLOCK_SPEED_MHZ	168
 
 static void					Adjust(SLIDER *slider) ;
+static void					Benchmark(BENCHMARK *bench, uint32_t frames) ;
 static int32_t				Between(uint32_t min, uint32_t val, uint32_t max) ;
 static void					BtmFlatTriangle(int x1, int x2, int xMin, int yMin, int yMax) ;
 static void					CheckSlider(void) ;
+static void					ChromArtEmulate(CHROM_ART *regs, CLR_RGB32 *clut) ;
 static void					ChromArtInitialize(void) ;
 static void					ChromArtWaitForDMA(void) ;
-static void					ChromArtXferFrameBuffer(CLR_RGB32 *screen_pixels, FRAME frame_pixels) ;
+static void					ChromArtXferFrameBuffer(CLR_RGB32 *screen_pixels, FRAME frame_pixels, RECT *rect) ;
+static void					ClearRect(FRAME frame_pixels, RECT *rect) ;
+static void					ConvertL4(CLR_RGB32 *dst, uint8_t *src, uint32_t phase, uint32_t pixels, CLR_RGB32 *clut) ;
+static void					ConvertL8(CLR_RGB32 *dst, uint8_t *src, uint32_t pixels, CLR_RGB32 *clut) ;
+static CLR_RGB32			FgPixel(uint8_t *src, uint32_t k, uint32_t cm, CLR_RGB32 *clut) ;
+static void					FillBytes(uint8_t *dst, uint8_t value, int count) ;
+static void					FillPixels(CLR_RGB32 *dst, CLR_RGB32 color, uint32_t pixels) ;
+static void					FillSpan(uint8_t *row, int xmin, int width, CLR_INDEX index) ;
 static uint32_t				GetTimeout(uint32_t msec) ;
 static void					DisplaySpeed(SLIDER *slider) ;
+static void					DisplayBenchmark(BENCHMARK *bench) ;
+static void					DisplaySweep(uint32_t sizes[], uint32_t cycles[], uint32_t culled[], int count) ;
+static void					DisplayTiming(TIMING *timing) ;
+static void					EmptyRect(RECT *rect) ;
+static void					ExtendRect(RECT *rect, int x, int y) ;
 static void					Error(char *function, char *format, ...) ;
-static void					GetScreenCoordinates(SCREEN_COORDINATE screen_coordinates[VERTICES], VERTEX *vertices[VERTICES]) ;
+static void					GetScreenCoordinates(SCREEN_COORDINATE screen_coordinates[VERTICES], uint8_t vertices[VERTICES]) ;
 static void					HorizLine(int x, int y, int width) ;
 static void					IdentityMatrix(MATRIX matrix) ;
+static void					InitializeScene(uint32_t count) ;
+static BOOL					InstanceInView(INSTANCE *instance) ;
+static void					InstanceMatrix(INSTANCE *instance, MATRIX matrix) ;
 static void					InitializeTouchScreen(void) ;
 static void					InitSlider(SLIDER *slider) ;
 static void					LEDs(int grn_on, int red_on) ;
-static void					MxM(MATRIX a, MATRIX b, MATRIX c) ;
-static void					MxV(VECTOR dstVector, MATRIX matrix, VECTOR srcVector) ;
+static uint32_t				MeasureXfer(void) ;
+static void					MxV(VECTOR dstVector, MATRIX matrix, const float *srcVector) ;
+static void					PaintInstance(INSTANCE *instance) ;
 static void					PaintTriangle(TRIANGLE *pTriangle) ;
+static uint32_t				PixelBits(uint32_t cm) ;
 static void					PutStringAt(int x, int y, char *fmt, ...) ;
-static void					RotateAboutXAxis(float radians, MATRIX matrix) ;
-static void					RotateAboutYAxis(float radians, MATRIX matrix) ;
-static void					RotateAboutZAxis(float radians, MATRIX matrix) ;
 static void					SanityCheck(void) ;
 static void					SetColorIndex(CLR_INDEX index) ;
 static void					SetFontSize(sFONT *pFont) ;
 static void					TopFlatTriangle(int x1, int x2, int xMax, int yMin, int yMax) ;
+static void					TransformVertices(MATRIX matrix, VECTOR position) ;
+static void					UnionRect(RECT *dst, RECT *rect1, RECT *rect2) ;
 static void					UpdateSlider(SLIDER *slider, uint32_t x) ;
 static void					UpdateValue(SLIDER *slider, uint32_t x) ;
 static BOOL					Visible(TRIANGLE *pTriangle) ;
-static float				VxV(VECTOR vec1, VECTOR vec2) ;
+static float				Cosine(ANGLE angle) ;
+static void					InitializeTrig(void) ;
+static void					QuatAboutAxis(QUATERNION *q, ANGLE angle, int axis) ;
+static void					QuatMultiply(QUATERNION *a, QUATERNION *b, QUATERNION *c) ;
+static void					QuatNormalize(QUATERNION *q) ;
+static void					QuatToMatrix(QUATERNION *q, MATRIX matrix) ;
+static float				Sine(ANGLE angle) ;
+static float				RandomFloat(float min, float max) ;
+static void					SpinScene(ANGLE spin[FRAME_DIMENSIONS]) ;
+static void					SpinStep(QUATERNION *step, ANGLE spin[FRAME_DIMENSIONS]) ;
+static void					Sweep(uint32_t frames) ;
+static float				VxV(const float *vec1, const float *vec2) ;
 static void					WaitForTimeout(uint32_t timeout, void (*func)(void)) ;
 
 static uint32_t *			AHB1ENR	= (uint32_t *)	0x40023800 ;
+#if CHROM_ART_EMULATION
+static CHROM_ART			chrom_art ;
+static CLR_RGB32			chrom_art_clut[CLUT_ENTRIES] ;
+static CHROM_ART *			DMA2D	= &chrom_art ;
+static CLR_RGB32 *			FG_CLUT = chrom_art_clut ;
+#else
 static CHROM_ART *			DMA2D	= (CHROM_ART *)	0x4002B000 ;
 static CLR_RGB32 *			FG_CLUT = (CLR_RGB32 *)	0x4002B400 ; 
+#endif
 static CLR_INDEX			clr_index = CLR_INDEX_WHITE ;
 static CLR_RGB32 *			screen_pixels = (CLR_RGB32 *) 0xD0000000 ;
-static FRAME				frame_pixels ;
+static FRAME				frame_buffers[FRAME_BUFFERS] ;
+static uint8_t				(*frame_pixels)[FRAME_BYTES] = frame_buffers[0] ;	// back buffer
+static RECT					damage[FRAME_BUFFERS] ;	// area last drawn in each buffer
+static RECT					bounds ;				// area drawn in current frame
+static TIMING				timing ;
+static BENCHMARK			benchmark ;
+
+// Define the vertices of the cube in one contiguous array. Each frame
+// transforms these, not last frame's result, so rounding can't accumulate.
+#define	FTL					0			// front top left
+#define	FTR					1			// front top right
+#define	FBL					2			// front bottom left
+#define	FBR					3			// front bottom right
+#define	RTL					4			// rear top left
+#define	RTR					5			// rear top right
+#define	RBL					6			// rear bottom left
+#define	RBR					7			// rear bottom right
+
+static const VERTEX			model[] =
+	{
+	{X_LEFT,	Y_TOP,		Z_FRONT},
+	{X_RIGHT,	Y_TOP,		Z_FRONT},
+	{X_LEFT,	Y_BOTTOM,	Z_FRONT},
+	{X_RIGHT,	Y_BOTTOM,	Z_FRONT},
+	{X_LEFT,	Y_TOP,		Z_REAR},
+	{X_RIGHT,	Y_TOP,		Z_REAR},
+	{X_LEFT,	Y_BOTTOM,	Z_REAR},
+	{X_RIGHT,	Y_BOTTOM,	Z_REAR}
+	} ;
 
-// Define the vertices of the cube ...
-static VERTEX 				ftl = {X_LEFT,	Y_TOP,		Z_FRONT} ;	// front top left
-static VERTEX 				ftr = {X_RIGHT,	Y_TOP,		Z_FRONT} ;	// front top right
-static VERTEX 				fbl = {X_LEFT,	Y_BOTTOM,	Z_FRONT} ;	// front bottom left
-static VERTEX 				fbr = {X_RIGHT,	Y_BOTTOM,	Z_FRONT} ;	// front bottom right
-static VERTEX 				rtl = {X_LEFT,	Y_TOP,		Z_REAR} ;	// rear top left
-static VERTEX 				rtr = {X_RIGHT,	Y_TOP,		Z_REAR} ;	// rear top right
-static VERTEX 				rbl = {X_LEFT,	Y_BOTTOM,	Z_REAR} ;	// rear bottom left
-static VERTEX 				rbr = {X_RIGHT,	Y_BOTTOM,	Z_REAR} ;	// rear bottom right
+// Vertex cache: every vertex is transformed and projected to the
+// screen once per instance, however many triangles share it.
+static VERTEX				transformed[ENTRIES(model)] ;
+static SCREEN_COORDINATE	projected[ENTRIES(model)] ;
 
-// Create an array of pointers to the vertices ...
-static VERTEX *				vertices[] = {&ftl, &ftr, &fbl, &fbr, &rtl, &rtr, &rbl, &rbr} ;
+// Rotation per frame about each axis, shared by every instance
+static ANGLE				spin[FRAME_DIMENSIONS] = {RADIANS(PI/25), RADIANS(PI/25), RADIANS(PI/25)} ;
+static float				sine[TRIG_STEPS + 1] ;
+
+// Each instance re-uses the vertices and triangles
+static INSTANCE				instances[MAX_INSTANCES] ;
+static uint32_t				instance_count ;
 
 // Define the cube as an array of triangles - two per face.
 // First vertex of each triangle must be at the 90 degree
 // corner & in clockwise order as seen from outside of cube.
 static TRIANGLE				triangles[] =
 	{
-	{{&rtl, &rtr, &ftl},	CLR_INDEX_YELLOW	},	// top
-	{{&ftr, &ftl, &rtr},	CLR_INDEX_YELLOW	},
+	{{RTL, RTR, FTL},	CLR_INDEX_YELLOW	},	// top
+	{{FTR, FTL, RTR},	CLR_INDEX_YELLOW	},
 
-	{{&ftl, &ftr, &fbl},	CLR_INDEX_GREEN		},	// front face
-	{{&fbr, &fbl, &ftr},	CLR_INDEX_GREEN		},
+	{{FTL, FTR, FBL},	CLR_INDEX_GREEN		},	// front face
+	{{FBR, FBL, FTR},	CLR_INDEX_GREEN		},
 
-	{{&rtl, &ftl, &rbl},	CLR_INDEX_RED		},	// left side
-	{{&fbl, &rbl, &ftl},	CLR_INDEX_RED		},
+	{{RTL, FTL, RBL},	CLR_INDEX_RED		},	// left side
+	{{FBL, RBL, FTL},	CLR_INDEX_RED		},
 
-	{{&rtl, &rbl, &rtr},	CLR_INDEX_CYAN		},	// rear face
-	{{&rbr, &rtr, &rbl},	CLR_INDEX_CYAN		},
+	{{RTL, RBL, RTR},	CLR_INDEX_CYAN		},	// rear face
+	{{RBR, RTR, RBL},	CLR_INDEX_CYAN		},
 
-	{{&rtr, &rbr, &ftr},	CLR_INDEX_BLUE		},	// right side
-	{{&fbr, &ftr, &rbr},	CLR_INDEX_BLUE		},
+	{{RTR, RBR, FTR},	CLR_INDEX_BLUE		},	// right side
+	{{FBR, FTR, RBR},	CLR_INDEX_BLUE		},
 
-	{{&fbl, &fbr, &rbl},	CLR_INDEX_MAGENTA	},	// bottom
-	{{&rbr, &rbl, &fbr},	CLR_INDEX_MAGENTA	}
+	{{FBL, FBR, RBL},	CLR_INDEX_MAGENTA	},	// bottom
+	{{RBR, RBL, FBR},	CLR_INDEX_MAGENTA	}
 	} ;
 
 static uint32_t msec = 60 ; // 20 RPM
@@ -245,54 +414,85 @@ static SLIDER slider = {"Speed", &msec, SLIDER_VMIN, SLIDER_VMAX, SLIDER_XMIN, S
 int main()
 	{
 	uint32_t timeout ;
-	MATRIX matrix ;
+	RECT previous, xfer ;
+	int back ;
 
 	InitializeHardware(NULL, "Lab 5a: Spinning Cube") ;
+
+	if (BENCHMARK_FRAMES != 0 || SWEEP_FRAMES != 0)
+		{
+		// No touch screen or slider; run flat out and report
+		SanityCheck() ;
+		ChromArtInitialize() ;
+		InitializeTrig() ;
+		if (SWEEP_FRAMES != 0) Sweep(SWEEP_FRAMES) ;
+		else
+			{
+			InitializeScene(SCENE_INSTANCES) ;
+			Benchmark(&benchmark, BENCHMARK_FRAMES) ;
+			DisplayBenchmark(&benchmark) ;
+			}
+		for (;;) ;
+		}
+
 	InitializeTouchScreen() ;
 	SanityCheck() ;
 	ChromArtInitialize() ;
 	InitSlider(&slider) ;
+	InitializeTrig() ;
+	InitializeScene(SCENE_INSTANCES) ;
+
+	timing.xfer = MeasureXfer() ;
 
-	// Create the transformation matrix
-	IdentityMatrix(matrix) ;
-	RotateAboutXAxis(PI/25, matrix) ;
-	RotateAboutYAxis(PI/25, matrix) ;
-	RotateAboutZAxis(PI/25, matrix) ;
+	// Both frame buffers and the display start out blank
+	for (back = 0; back < FRAME_BUFFERS; back++) EmptyRect(&damage[back]) ;
+	EmptyRect(&previous) ;
 
+	back = 0 ;
 	timeout = GetTimeout(msec) ;
 	for (;;)
 		{
-		TRIANGLE *pTriangle ;
-		VERTEX **ppVertex ;
+		uint32_t strt, stop ;
 		int k ;
 
-		// Let DMA finish copying the frame buffer to the
-		// display buffer before modifying the frame buffer
-		ChromArtWaitForDMA() ;
-
 		// Pause if user presses push button
 		while (PushButtonPressed()) ;
 
-		// Erase the frame buffer (remove triangles)
-		memset(frame_pixels, CLR_INDEX_WHITE, sizeof(frame_pixels)) ;
+		// Draw into the back buffer; the DMA2D may still be
+		// reading the front buffer from the previous frame.
+		frame_pixels = frame_buffers[back] ;
+		strt = GetClockCycleCount() ;
 
-		// Transform all the vertices
-		ppVertex = &vertices[0] ;
-		for (k = 0; k < ENTRIES(vertices); k++, ppVertex++)
-			{
-			MxV((float *) *ppVertex, matrix, (float *) *ppVertex) ;
-			}
+		// Erase only what was drawn the last time this buffer was used
+		ClearRect(frame_pixels, &damage[back]) ;
+		EmptyRect(&bounds) ;
 
-		// Paint visible triangles to the frame buffer
-		pTriangle = &triangles[0] ;
-		for (k = 0; k < ENTRIES(triangles); k++, pTriangle++)
+		// Advance every orientation, then paint each cube in view
+		SpinScene(spin) ;
+		for (k = 0; k < instance_count; k++)
 			{
-			if (Visible(pTriangle)) PaintTriangle(pTriangle) ;
+			if (InstanceInView(&instances[k])) PaintInstance(&instances[k]) ;
 			}
 
+		stop = GetClockCycleCount() ;
+		timing.render += stop - strt ;
+
+		// The display must be updated wherever the cube
+		// was in the previous frame or is in this one
+		UnionRect(&xfer, &previous, &bounds) ;
+		damage[back] = previous = bounds ;
+
+		// Only now must the previous transfer be complete
+		ChromArtWaitForDMA() ;
+		strt = GetClockCycleCount() ;
+		timing.stall += strt - stop ;
+
 		// Copy frame buffer to display buffer; Chrom-Art Controller
 		// automatically converts L8 (256 color table) to ARGB8888 format
-		ChromArtXferFrameBuffer(screen_pixels, frame_pixels) ;
+		ChromArtXferFrameBuffer(screen_pixels, frame_pixels, &xfer) ;
+		back = (back + 1) % FRAME_BUFFERS ;
+
+		if (++timing.frames == TIMING_FRAMES) DisplayTiming(&timing) ;
 
 		// Limit the cube's rotation rate
 		WaitForTimeout(timeout, CheckSlider) ;
@@ -302,6 +502,239 @@ int main()
 	return 0 ;
 	}
 
+static void InitializeScene(uint32_t count)
+	{
+	// A single cube fills the middle of the frame as it always
+	// has; more are scattered at random, some partly or wholly
+	// outside the frame so that view rejection is exercised.
+	INSTANCE *instance ;
+	int k ;
+
+	instance_count = count ;
+	instance = &instances[0] ;
+	for (k = 0; k < count; k++, instance++)
+		{
+		if (count == 1)
+			{
+			memset(instance->position, 0, sizeof(VECTOR)) ;
+			instance->scale = 1.0 ;
+			instance->orientation = (QUATERNION) {1.0, 0.0, 0.0, 0.0} ;
+			}
+		else
+			{
+			instance->position[0] = RandomFloat(1.2*MODEL_XMIN, 1.2*MODEL_XMAX) ;
+			instance->position[1] = RandomFloat(1.2*MODEL_YMIN, 1.2*MODEL_YMAX) ;
+			instance->position[2] = 0.0 ;
+			instance->scale = RandomFloat(0.1, 0.3) ;
+			instance->orientation.w = RandomFloat(-1.0, +1.0) ;
+			instance->orientation.x = RandomFloat(-1.0, +1.0) ;
+			instance->orientation.y = RandomFloat(-1.0, +1.0) ;
+			instance->orientation.z = RandomFloat(-1.0, +1.0) ;
+			QuatNormalize(&instance->orientation) ;
+			}
+		instance->radius = CUBE_RADIUS * instance->scale ;
+		}
+	}
+
+static float RandomFloat(float min, float max)
+	{
+	return min + (max - min) * ((float) GetRandomNumber() / UINT32_MAX) ;
+	}
+
+static BOOL InstanceInView(INSTANCE *instance)
+	{
+	// Reject the instance if its bounding sphere misses the frame
+	float x = instance->position[0] ;
+	float y = instance->position[1] ;
+	float r = instance->radius ;
+
+	if (x + r < MODEL_XMIN || x - r > MODEL_XMAX) return FALSE ;
+	if (y + r < MODEL_YMIN || y - r > MODEL_YMAX) return FALSE ;
+	return TRUE ;
+	}
+
+static void InstanceMatrix(INSTANCE *instance, MATRIX matrix)
+	{
+	// matrix <-- rotation of the instance, scaled to its size
+	float *pFloat ;
+	int k ;
+
+	QuatToMatrix(&instance->orientation, matrix) ;
+	pFloat = (float *) matrix ;
+	for (k = 0; k < MATRIX_ROWS*MATRIX_COLS; k++)
+		{
+		*pFloat++ *= instance->scale ;
+		}
+	}
+
+static void PaintInstance(INSTANCE *instance)
+	{
+	TRIANGLE *pTriangle ;
+	MATRIX matrix ;
+	int k ;
+
+	InstanceMatrix(instance, matrix) ;
+	TransformVertices(matrix, instance->position) ;
+
+	// Paint visible triangles to the frame buffer
+	pTriangle = &triangles[0] ;
+	for (k = 0; k < ENTRIES(triangles); k++, pTriangle++)
+		{
+		if (Visible(pTriangle)) PaintTriangle(pTriangle) ;
+		}
+	}
+
+static void TransformVertices(MATRIX matrix, VECTOR position)
+	{
+	VERTEX *pVertex ;
+	int k ;
+
+	pVertex = &transformed[0] ;
+	for (k = 0; k < ENTRIES(model); k++, pVertex++)
+		{
+		MxV((float *) pVertex, matrix, (const float *) &model[k]) ;
+		pVertex->x += position[0] ;
+		pVertex->y += position[1] ;
+		pVertex->z += position[2] ;
+
+		// Convert floating-point vertex coordinates
+		// to screen row and column coordinates
+		projected[k][0] = X_CENTER + (int) SIZE*pVertex->x ;
+		projected[k][1] = Y_CENTER + (int) SIZE*pVertex->y ;
+		}
+	}
+
+static void Benchmark(BENCHMARK *bench, uint32_t frames)
+	{
+	// Same pipeline as main, one buffer and no frame-rate
+	// limit, with every stage timed on its own. Transfers
+	// are waited for so their cost isn't hidden in the next.
+	uint32_t strt, stop, ovhd, begin ;
+	TRIANGLE *pTriangle ;
+	INSTANCE *instance ;
+	MATRIX matrix ;
+	RECT previous, xfer ;
+	int i, k ;
+
+	memset(bench, 0, sizeof(BENCHMARK)) ;
+
+	strt = GetClockCycleCount() ;
+	stop = GetClockCycleCount() ;
+	ovhd = stop - strt ;
+
+	frame_pixels = frame_buffers[0] ;
+	memset(frame_pixels, FRAME_FILL(CLR_INDEX_WHITE), sizeof(FRAME)) ;
+	EmptyRect(&damage[0]) ;
+	EmptyRect(&previous) ;
+
+	for (bench->frames = 0; bench->frames < frames; bench->frames++)
+		{
+		begin = GetClockCycleCount() ;
+		strt = GetClockCycleCount() ;
+		ClearRect(frame_pixels, &damage[0]) ;
+		EmptyRect(&bounds) ;
+		stop = GetClockCycleCount() ;
+		bench->clear += stop - strt - ovhd ;
+
+		strt = GetClockCycleCount() ;
+		SpinScene(spin) ;
+		stop = GetClockCycleCount() ;
+		bench->transform += stop - strt - ovhd ;
+
+		instance = &instances[0] ;
+		for (i = 0; i < instance_count; i++, instance++)
+			{
+			strt = GetClockCycleCount() ;
+			if (!InstanceInView(instance))
+				{
+				bench->culled++ ;
+				stop = GetClockCycleCount() ;
+				bench->cull += stop - strt - ovhd ;
+				continue ;
+				}
+			InstanceMatrix(instance, matrix) ;
+			TransformVertices(matrix, instance->position) ;
+			stop = GetClockCycleCount() ;
+			bench->transform += stop - strt - ovhd ;
+
+			pTriangle = &triangles[0] ;
+			for (k = 0; k < ENTRIES(triangles); k++, pTriangle++)
+				{
+				BOOL visible ;
+
+				strt = GetClockCycleCount() ;
+				visible = Visible(pTriangle) ;
+				stop = GetClockCycleCount() ;
+				bench->cull += stop - strt - ovhd ;
+				if (!visible) continue ;
+
+				strt = GetClockCycleCount() ;
+				PaintTriangle(pTriangle) ;
+				stop = GetClockCycleCount() ;
+				bench->paint += stop - strt - ovhd ;
+				}
+			}
+
+		strt = GetClockCycleCount() ;
+		UnionRect(&xfer, &previous, &bounds) ;
+		damage[0] = previous = bounds ;
+		ChromArtXferFrameBuffer(screen_pixels, frame_pixels, &xfer) ;
+		ChromArtWaitForDMA() ;
+		stop = GetClockCycleCount() ;
+		bench->xfer += stop - strt - ovhd ;
+		bench->total += stop - begin ;
+		}
+	}
+
+static void DisplayBenchmark(BENCHMARK *bench)
+	{
+	uint32_t frames = bench->frames ;
+
+	SetForeground(COLOR_BLACK) ;
+	SetBackground(COLOR_WHITE) ;
+	PutStringAt(TIMING_XPOS, BENCH_ROW(0), "Benchmark: %u frames, %u cubes", frames, instance_count) ;
+	PutStringAt(TIMING_XPOS, BENCH_ROW(1), "Frames/sec: %.1f", frames * (CPU_CLOCK_SPEED_MHZ * 1E6) / bench->total) ;
+	PutStringAt(TIMING_XPOS, BENCH_ROW(3), "Cycles per frame:") ;
+	PutStringAt(TIMING_XPOS, BENCH_ROW(4), "      Clear:%8u", (uint32_t) (bench->clear / frames)) ;
+	PutStringAt(TIMING_XPOS, BENCH_ROW(5), "  Transform:%8u", (uint32_t) (bench->transform / frames)) ;
+	PutStringAt(TIMING_XPOS, BENCH_ROW(6), "    Visible:%8u", (uint32_t) (bench->cull / frames)) ;
+	PutStringAt(TIMING_XPOS, BENCH_ROW(7), "      Paint:%8u", (uint32_t) (bench->paint / frames)) ;
+	PutStringAt(TIMING_XPOS, BENCH_ROW(8), "   Transfer:%8u", (uint32_t) (bench->xfer / frames)) ;
+	PutStringAt(TIMING_XPOS, BENCH_ROW(9), "      Total:%8u", (uint32_t) (bench->total / frames)) ;
+	}
+
+static void Sweep(uint32_t frames)
+	{
+	// How frame time grows with the number of cubes
+	static uint32_t sizes[] = {10, 20, 50, 100, 200, 500} ;
+	uint32_t cycles[ENTRIES(sizes)], culled[ENTRIES(sizes)] ;
+	int k ;
+
+	for (k = 0; k < ENTRIES(sizes); k++)
+		{
+		InitializeScene(sizes[k]) ;
+		Benchmark(&benchmark, frames) ;
+		cycles[k] = (uint32_t) (benchmark.total / frames) ;
+		culled[k] = benchmark.culled / frames ;
+		}
+
+	DisplaySweep(sizes, cycles, culled, ENTRIES(sizes)) ;
+	}
+
+static void DisplaySweep(uint32_t sizes[], uint32_t cycles[], uint32_t culled[], int count)
+	{
+	int k ;
+
+	SetForeground(COLOR_BLACK) ;
+	SetBackground(COLOR_WHITE) ;
+	PutStringAt(TIMING_XPOS, BENCH_ROW(0), "Cubes Culled  Cyc/frame  Frm/s") ;
+	for (k = 0; k < count; k++)
+		{
+		PutStringAt(TIMING_XPOS, BENCH_ROW(k + 1), "%5u %6u %10u %6.1f",
+			sizes[k], culled[k], cycles[k], (CPU_CLOCK_SPEED_MHZ * 1E6) / cycles[k]) ;
+		}
+	}
+
 static void CheckSlider(void)
 	{
 	if (TS_Touched()) Adjust(&slider) ;
@@ -314,8 +747,7 @@ static void SetColorIndex(CLR_INDEX index)
 
 static void HorizLine(int x, int y, int width)
 	{
-	int k, xmin, xmax ;
-	CLR_INDEX *pPixel ;
+	int xmin, xmax ;
 
 	// Clip line to frame boundaries ...
 	if (y < 0 || y >= FRAME_ROWS) return ;
@@ -325,11 +757,58 @@ static void HorizLine(int x, int y, int width)
 	if (width <= 0) return ;
 
 	// Paint line to frame buffer
-	pPixel = &frame_pixels[y][xmin] ;
-	for (k = 0; k < width; k++)
+	FillSpan(frame_pixels[y], xmin, width, clr_index) ;
+	}
+
+static void FillSpan(uint8_t *row, int xmin, int width, CLR_INDEX index)
+	{
+	// Set pixels xmin through xmin+width-1 of one frame row
+	uint8_t *pByte ;
+	int xmax ;
+
+	if (!FRAME_L4)
 		{
-		*pPixel++ = clr_index ;
+		FillBytes(&row[xmin], index, width) ;
+		return ;
 		}
+
+	// Odd pixels at either end share a byte with their neighbor
+	xmax = xmin + width ;
+	if (xmin & 1)
+		{
+		pByte = &row[xmin/2] ;
+		*pByte = (*pByte & 0x0F) | (index << 4) ;
+		xmin++ ;
+		}
+	if (xmax & 1 && xmax > xmin)
+		{
+		pByte = &row[xmax/2] ;
+		*pByte = (*pByte & 0xF0) | index ;
+		xmax-- ;
+		}
+	if (xmax > xmin) FillBytes(&row[xmin/2], 0x11 * index, (xmax - xmin)/2) ;
+	}
+
+static void FillBytes(uint8_t *dst, uint8_t value, int count)
+	{
+	// Byte stores up to a word boundary, then whole words
+	uint32_t *pWord, word ;
+
+	while (count > 0 && ((uint32_t) dst & 3) != 0)
+		{
+		*dst++ = value ;
+		count-- ;
+		}
+
+	word = value * 0x01010101 ;
+	pWord = (uint32_t *) dst ;
+	for (; count >= 4; count -= 4)
+		{
+		*pWord++ = word ;
+		}
+
+	dst = (uint8_t *) pWord ;
+	while (count-- > 0) *dst++ = value ;
 	}
 
 static void BtmFlatTriangle(int x1, int x2, int xMin, int yMin, int yMax)
@@ -425,7 +904,7 @@ static void PaintTriangle(TRIANGLE *pTriangle)
 	SCREEN_COORDINATE screen_coordinates[VERTICES] ;
 #	define	X(k)	(screen_coordinates[k][0])
 #	define	Y(k)	(screen_coordinates[k][1])
-	int x3, dvnd, dvsr ;
+	int x3, dvnd, dvsr, k ;
 
 	GetScreenCoordinates(screen_coordinates, pTriangle->vertices) ;
 
@@ -436,6 +915,9 @@ static void PaintTriangle(TRIANGLE *pTriangle)
 	dvsr = Y(2) - Y(0) ;
 	if (dvsr == 0) return ;
 
+	// Grow the damaged area to cover this triangle
+	for (k = 0; k < VERTICES; k++) ExtendRect(&bounds, X(k), Y(k)) ;
+
 	SetColorIndex(pTriangle->clr_index) ;
 
 	// Divide into two right triangles
@@ -448,32 +930,32 @@ static void PaintTriangle(TRIANGLE *pTriangle)
 
 static BOOL Visible(TRIANGLE *pTriangle)
 	{
+	VERTEX *v0 = &transformed[pTriangle->vertices[0]] ;
+	VERTEX *v1 = &transformed[pTriangle->vertices[1]] ;
+	VERTEX *v2 = &transformed[pTriangle->vertices[2]] ;
 	float dx1, dy1, dx2, dy2 ;
 
 	// Surface normal is cross-product of two sides
-	dx1 = pTriangle->vertices[0]->x - pTriangle->vertices[1]->x ;
-	dy1 = pTriangle->vertices[0]->y - pTriangle->vertices[1]->y ;
+	dx1 = v0->x - v1->x ;
+	dy1 = v0->y - v1->y ;
 
-	dx2 = pTriangle->vertices[1]->x - pTriangle->vertices[2]->x ;
-	dy2 = pTriangle->vertices[1]->y - pTriangle->vertices[2]->y ;
+	dx2 = v1->x - v2->x ;
+	dy2 = v1->y - v2->y ;
 
 	// Return TRUE if surface normal points towards us
 	return (dx1 * dy2) < (dy1 * dx2) ;
 	}
 
-static void GetScreenCoordinates(SCREEN_COORDINATE screen_coordinates[VERTICES], VERTEX *vertices[VERTICES])
+static void GetScreenCoordinates(SCREEN_COORDINATE screen_coordinates[VERTICES], uint8_t vertices[VERTICES])
 	{
-	VERTEX **ppVertex ;
 	int k, x, y ;
 
-	// Convert floating-point vertex coordinates
-	// to screen row and column coordinates
-	ppVertex = &vertices[0] ;
-	for (k = 0; k < VERTICES; k++, ppVertex++)
+	// Fetch the already-projected vertices from the cache
+	for (k = 0; k < VERTICES; k++)
 		{
 		int *pPixel = screen_coordinates[k] ;
-		pPixel[0] = X_CENTER + (int) SIZE*(*ppVertex)->x ;
-		pPixel[1] = Y_CENTER + (int) SIZE*(*ppVertex)->y ;
+		pPixel[0] = projected[vertices[k]][0] ;
+		pPixel[1] = projected[vertices[k]][1] ;
 
 		// vertex 0 is at the 90 degree corner;
 		// extend the opposite edge to avoid gap
@@ -485,44 +967,31 @@ static void GetScreenCoordinates(SCREEN_COORDINATE screen_coordinates[VERTICES],
 		}
 	}
 
-static float VxV(VECTOR v1, VECTOR v2)
+static float VxV(const float *v1, const float *v2)
 	{
 	// Dot Product: Scalar (returned) <-- Vector (v1) * Vector (v2)
+	// Unrolled for FRAME_DIMENSIONS == 3; each step is one VFMA.
 	float sum ;
-	int k ;
 
-	sum = 0.0 ;
-	for (k = 0; k < MATRIX_COLS; k++)
-		{
-		sum += v1[k] * v2[k] ;
-		}
-
-	return sum;
+	sum = v1[0] * v2[0] ;
+	sum = fmaf(v1[1], v2[1], sum) ;
+	sum = fmaf(v1[2], v2[2], sum) ;
+	return sum ;
 	}
 
-static void MxV(VECTOR dstVector, MATRIX matrix, VECTOR srcVector)
+static void MxV(VECTOR dstVector, MATRIX matrix, const float *srcVector)
 	{
 	// Vector (vdst) <-- Matrix (matrix) * Vector (vsrc)
-	float *pFloat, *pMatrixRow ;
-	VECTOR tmpVector ;
-	int row ;
-
-	pFloat = tmpVector ; pMatrixRow = (float *) matrix ;
-	for (row = 0; row < MATRIX_ROWS; row++)
-		{
-		*pFloat++ = VxV(pMatrixRow, srcVector) ;
-		pMatrixRow += MATRIX_COLS ;
-		}
-	memcpy(dstVector, tmpVector, sizeof(tmpVector)) ;
-	}
+	// Rows are summed into locals first so vdst may be vsrc.
+	float x, y, z ;
 
-static void MxM(MATRIX a, MATRIX b, MATRIX c)
-	{
-	// Matrix (a) <-- Matrix (b) * Matrix (c)
-	MATRIX tmpMatrix ;
+	x = VxV(matrix[0], srcVector) ;
+	y = VxV(matrix[1], srcVector) ;
+	z = VxV(matrix[2], srcVector) ;
 
-	MatrixMultiply((void *) tmpMatrix, (void *) b, (void *) c) ;
-	memcpy(a, tmpMatrix, sizeof(tmpMatrix)) ;
+	dstVector[0] = x ;
+	dstVector[1] = y ;
+	dstVector[2] = z ;
 	}
 
 static void IdentityMatrix(MATRIX matrix)
@@ -538,43 +1007,110 @@ static void IdentityMatrix(MATRIX matrix)
 	memcpy(matrix, ident, sizeof(MATRIX)) ;
 	}
 
-static void RotateAboutZAxis(float radians, MATRIX matrix)
+static void InitializeTrig(void)
+	{
+	// One extra entry lets Sine interpolate past the last step
+	int k ;
+
+	for (k = 0; k <= TRIG_STEPS; k++)
+		{
+		sine[k] = sin(2*PI*k / TRIG_STEPS) ;
+		}
+	}
+
+static float Sine(ANGLE angle)
 	{
-	MATRIX tmpMatrix ;
+	// Linear interpolation between adjacent table entries
+	uint32_t index = angle >> TRIG_FRAC ;
+	float frac = (angle & ((1 << TRIG_FRAC) - 1)) * (1.0 / (1 << TRIG_FRAC)) ;
+	return sine[index] + frac * (sine[index + 1] - sine[index]) ;
+	}
 
-	memset(tmpMatrix, 0, sizeof(MATRIX)) ;
-	tmpMatrix[0][0] = +cos(radians) ;
-	tmpMatrix[0][1] = -sin(radians) ;
-	tmpMatrix[1][0] = +sin(radians) ;
-	tmpMatrix[1][1] = +cos(radians) ;
-	tmpMatrix[2][2] = +1.0 ;
-	MxM(matrix, matrix, tmpMatrix) ;
+static float Cosine(ANGLE angle)
+	{
+	return Sine(angle + (1u << 30)) ;	// cos(a) = sin(a + 90 degrees)
 	}
 
-static void RotateAboutYAxis(float radians, MATRIX matrix)
+static void QuatAboutAxis(QUATERNION *q, ANGLE angle, int axis)
 	{
-	MATRIX tmpMatrix ;
+	// q <-- rotation by angle about one coordinate axis
+	float s = Sine(angle / 2) ;
 
-	memset(tmpMatrix, 0, sizeof(MATRIX)) ;
-	tmpMatrix[0][0] = +cos(radians) ;
-	tmpMatrix[0][2] = +sin(radians) ;
-	tmpMatrix[1][1] = +1.0 ;
-	tmpMatrix[2][0] = -sin(radians) ;
-	tmpMatrix[2][2] = +cos(radians) ;
-	MxM(matrix, matrix, tmpMatrix) ;
+	q->w = Cosine(angle / 2) ;
+	q->x = (axis == AXIS_X) ? s : 0.0 ;
+	q->y = (axis == AXIS_Y) ? s : 0.0 ;
+	q->z = (axis == AXIS_Z) ? s : 0.0 ;
+	}
+
+static void QuatMultiply(QUATERNION *a, QUATERNION *b, QUATERNION *c)
+	{
+	// Quaternion (a) <-- Quaternion (b) * Quaternion (c)
+	QUATERNION tmp ;
+
+	tmp.w = b->w*c->w - b->x*c->x - b->y*c->y - b->z*c->z ;
+	tmp.x = b->w*c->x + b->x*c->w + b->y*c->z - b->z*c->y ;
+	tmp.y = b->w*c->y - b->x*c->z + b->y*c->w + b->z*c->x ;
+	tmp.z = b->w*c->z + b->x*c->y - b->y*c->x + b->z*c->w ;
+	*a = tmp ;
 	}
 
-static void RotateAboutXAxis(float radians, MATRIX matrix)
+static void QuatNormalize(QUATERNION *q)
 	{
-	MATRIX tmpMatrix ;
+	float scale = 1.0 / sqrtf(q->w*q->w + q->x*q->x + q->y*q->y + q->z*q->z) ;
 
-	memset(tmpMatrix, 0, sizeof(MATRIX)) ;
-	tmpMatrix[0][0] = +1.0 ;
-	tmpMatrix[1][1] = +cos(radians) ;
-	tmpMatrix[1][2] = -sin(radians) ;
-	tmpMatrix[2][1] = +sin(radians) ;
-	tmpMatrix[2][2] = +cos(radians) ;
-	MxM(matrix, matrix, tmpMatrix) ;
+	q->w *= scale ;
+	q->x *= scale ;
+	q->y *= scale ;
+	q->z *= scale ;
+	}
+
+static void SpinStep(QUATERNION *step, ANGLE spin[FRAME_DIMENSIONS])
+	{
+	// One frame of angular velocity as a quaternion;
+	// same order as rotating about X, then Y, then Z.
+	QUATERNION axis ;
+
+	QuatAboutAxis(step, spin[AXIS_X], AXIS_X) ;
+	QuatAboutAxis(&axis, spin[AXIS_Y], AXIS_Y) ;
+	QuatMultiply(step, step, &axis) ;
+	QuatAboutAxis(&axis, spin[AXIS_Z], AXIS_Z) ;
+	QuatMultiply(step, step, &axis) ;
+	}
+
+static void SpinScene(ANGLE spin[FRAME_DIMENSIONS])
+	{
+	// Integrate the step into every instance's orientation
+	QUATERNION step ;
+	INSTANCE *instance ;
+	int k ;
+
+	SpinStep(&step, spin) ;
+	instance = &instances[0] ;
+	for (k = 0; k < instance_count; k++, instance++)
+		{
+		QuatMultiply(&instance->orientation, &step, &instance->orientation) ;
+		QuatNormalize(&instance->orientation) ;
+		}
+	}
+
+static void QuatToMatrix(QUATERNION *q, MATRIX matrix)
+	{
+	// matrix <-- rotation equivalent to unit quaternion q
+	float xx = q->x*q->x, yy = q->y*q->y, zz = q->z*q->z ;
+	float xy = q->x*q->y, xz = q->x*q->z, yz = q->y*q->z ;
+	float wx = q->w*q->x, wy = q->w*q->y, wz = q->w*q->z ;
+
+	matrix[0][0] = 1.0 - 2*(yy + zz) ;
+	matrix[0][1] = 2*(xy - wz) ;
+	matrix[0][2] = 2*(xz + wy) ;
+
+	matrix[1][0] = 2*(xy + wz) ;
+	matrix[1][1] = 1.0 - 2*(xx + zz) ;
+	matrix[1][2] = 2*(yz - wx) ;
+
+	matrix[2][0] = 2*(xz - wy) ;
+	matrix[2][1] = 2*(yz + wx) ;
+	matrix[2][2] = 1.0 - 2*(xx + yy) ;
 	}
 
 static uint32_t GetTimeout(uint32_t msec)
@@ -599,6 +1135,20 @@ static void ChromArtWaitForDMA(void)
 		}
 	}
 
+static uint32_t MeasureXfer(void)
+	{
+	// Cycles for one transfer with nothing overlapping it
+	RECT full = {0, 0, FRAME_COLS - 1, XFER_ROWS - 1} ;
+	uint32_t strt, stop ;
+
+	memset(frame_buffers[0], FRAME_FILL(CLR_INDEX_WHITE), sizeof(FRAME)) ;
+	strt = GetClockCycleCount() ;
+	ChromArtXferFrameBuffer(screen_pixels, frame_buffers[0], &full) ;
+	ChromArtWaitForDMA() ;
+	stop = GetClockCycleCount() ;
+	return stop - strt ;
+	}
+
 static void ChromArtInitialize(void)
 	{
 	static uint32_t color_table[] =
@@ -613,8 +1163,11 @@ static void ChromArtInitialize(void)
 		} ;
 	int k ;
 
-	*AHB1ENR |= (1 << 23) ;	// Turn on DMA2D clock
-	WaitForTimeout(GetTimeout(1), NULL) ;
+	if (!CHROM_ART_EMULATION)
+		{
+		*AHB1ENR |= (1 << 23) ;	// Turn on DMA2D clock
+		WaitForTimeout(GetTimeout(1), NULL) ;
+		}
 
 	// Load color look-up table (CLUT)
 	for (k = 0; k < ENTRIES(color_table); k++)
@@ -623,20 +1176,235 @@ static void ChromArtInitialize(void)
 		}
 	}
 
-static void ChromArtXferFrameBuffer(CLR_RGB32 *screen_pixels, FRAME frame_pixels)
+static void ChromArtXferFrameBuffer(CLR_RGB32 *screen_pixels, FRAME frame_pixels, RECT *rect)
 	{
-	DMA2D->NLR		= (FRAME_COLS << 16) | (FRAME_ROWS - 20) ; 
+	int xmin, ymin, width, height ;
+
+	// Clip to the part of the frame shown above the slider
+	xmin	= MAX(rect->xmin, 0) ;
+	ymin	= MAX(rect->ymin, 0) ;
+	width	= MIN(rect->xmax, FRAME_COLS - 1) - xmin + 1 ;
+	height	= MIN(rect->ymax, XFER_ROWS - 1) - ymin + 1 ;
+	if (width <= 0 || height <= 0) return ;
+
+	// L4 lines must start and end on a byte boundary
+	if (FRAME_L4)
+		{
+		width += xmin & 1 ;
+		xmin  &= ~1 ;
+		width += width & 1 ;
+		}
 
-	DMA2D->OMAR		= (uint32_t) (screen_pixels + XPIXELS*DISPLAY_YOFF + DISPLAY_XOFF) ;
-	DMA2D->OOR		= 0 ;
+	DMA2D->NLR		= (width << 16) | height ; 
+
+	DMA2D->OMAR		= (uint32_t) (screen_pixels + XPIXELS*(DISPLAY_YOFF + ymin) + DISPLAY_XOFF + xmin) ;
+	DMA2D->OOR		= XPIXELS - width ;	// skip rest of display row.
 	DMA2D->OPFCCR	= 0 ;	// Output pixel format ARGB8888.
 
-	DMA2D->FGMAR	= (uint32_t) frame_pixels ;	// foreground (source buffer) address.
-	DMA2D->FGOR		= 0 ;	// pixels rows are adjacent in source.
-	DMA2D->FGPFCCR	= 5 ;	// Source pixel format L8.
+	DMA2D->FGMAR	= (uint32_t) &frame_pixels[ymin][xmin * FRAME_BYTES / FRAME_COLS] ;	// foreground (source buffer) address.
+	DMA2D->FGOR		= FRAME_COLS - width ;	// skip rest of frame row (in pixels).
+	DMA2D->FGPFCCR	= FRAME_CM ;	// Source pixel format L4 or L8.
 
 	// start transfer; Enable PFC (Pixel Format Conversion)
 	DMA2D->CR		= 0x10001 ;
+	if (CHROM_ART_EMULATION) ChromArtEmulate(DMA2D, FG_CLUT) ;
+	}
+
+static void ChromArtEmulate(CHROM_ART *regs, CLR_RGB32 *clut)
+	{
+	// Carry out the transfer programmed into regs on the CPU, then
+	// clear the start bit as the DMA2D would. Output is ARGB8888,
+	// except that M2M copies pixels in the source format; the
+	// background of a blend must also be ARGB8888.
+	uint32_t mode, cm, bits, obits, pixels, lines, line, nibble, phase, k ;
+	uint8_t *src, *out ;
+	CLR_RGB32 *dst, *bkg ;
+
+	mode	= (regs->CR >> 16) & 3 ;
+	cm		= regs->FGPFCCR & 0xF ;
+	pixels	= regs->NLR >> 16 ;
+	lines	= regs->NLR & 0xFFFF ;
+
+	// A fill has no source, so FGPFCCR means nothing to it
+	bits	= (mode == DMA2D_MODE_R2M) ? 0 : PixelBits(cm) ;
+	obits	= 32 ;
+	if (mode == DMA2D_MODE_M2M)
+		{
+		// No conversion, so the output must already be in the source format
+		if ((regs->OPFCCR & 0x7) != cm)
+			Error("ChromArtEmulate", "M2M from mode %u to %u", cm, regs->OPFCCR & 0x7) ;
+		obits = bits ;
+		}
+
+	// The source is tracked in nibbles, as an L4 line can start mid-byte
+	nibble = 0 ;
+	bkg = (CLR_RGB32 *) regs->BGMAR ;
+	out = (uint8_t *) regs->OMAR ;
+	for (line = 0; line < lines; line++)
+		{
+		src = (uint8_t *) regs->FGMAR + nibble / 2 ;
+		phase = nibble & 1 ;
+		dst = (CLR_RGB32 *) out ;
+		switch (mode)
+			{
+			case DMA2D_MODE_R2M:
+				FillPixels(dst, regs->OCOLR, pixels) ;
+				break ;
+
+			case DMA2D_MODE_M2M:
+				memcpy(out, src, pixels * bits / 8) ;
+				break ;
+
+			case DMA2D_MODE_PFC:
+				if		(cm == DMA2D_CM_L8) ConvertL8(dst, src, pixels, clut) ;
+				else if	(cm == DMA2D_CM_L4) ConvertL4(dst, src, phase, pixels, clut) ;
+				else for (k = 0; k < pixels; k++) dst[k] = FgPixel(src, k, cm, clut) ;
+				break ;
+
+			case DMA2D_MODE_BLEND:
+				for (k = 0; k < pixels; k++)
+					{
+					CLR_RGB32 fg = FgPixel(src, phase + k, cm, clut) ;
+					CLR_RGB32 bg = bkg[k] ;
+					uint32_t alpha = fg >> 24 ;
+					uint32_t r = (alpha*((fg >> 16) & 0xFF) + (255 - alpha)*((bg >> 16) & 0xFF)) / 255 ;
+					uint32_t g = (alpha*((fg >>  8) & 0xFF) + (255 - alpha)*((bg >>  8) & 0xFF)) / 255 ;
+					uint32_t b = (alpha*((fg >>  0) & 0xFF) + (255 - alpha)*((bg >>  0) & 0xFF)) / 255 ;
+					dst[k] = (0xFF << 24) | (r << 16) | (g << 8) | b ;
+					}
+				bkg += pixels + regs->BGOR ;
+				break ;
+			}
+		nibble += (pixels + regs->FGOR) * bits / 4 ;
+		out += (pixels + regs->OOR) * obits / 8 ;
+		}
+
+	regs->CR &= ~1 ;		// transfer complete
+	regs->ISR |= 1 << 1 ;	// TCIF
+	}
+
+static uint32_t PixelBits(uint32_t cm)
+	{
+	switch (cm)
+		{
+		case DMA2D_CM_ARGB8888:	return 32 ;
+		case DMA2D_CM_RGB565:	return 16 ;
+		case DMA2D_CM_L8:		return 8 ;
+		case DMA2D_CM_L4:		return 4 ;
+		}
+	Error("ChromArtEmulate", "Color mode %u unsupported", cm) ;
+	return 0 ;
+	}
+
+static CLR_RGB32 FgPixel(uint8_t *src, uint32_t k, uint32_t cm, CLR_RGB32 *clut)
+	{
+	uint32_t r, g, b ;
+	uint16_t rgb ;
+
+	switch (cm)
+		{
+		case DMA2D_CM_L8:	return clut[src[k]] ;
+		case DMA2D_CM_L4:	return clut[(src[k/2] >> (4*(k & 1))) & 0xF] ;
+		case DMA2D_CM_RGB565:
+			rgb = ((uint16_t *) src)[k] ;
+			r = (rgb >> 11) & 0x1F ;
+			g = (rgb >>  5) & 0x3F ;
+			b = (rgb >>  0) & 0x1F ;
+			return (0xFF << 24) | (((r << 3) | (r >> 2)) << 16) | (((g << 2) | (g >> 4)) << 8) | ((b << 3) | (b >> 2)) ;
+		}
+	return ((CLR_RGB32 *) src)[k] ;
+	}
+
+static void ConvertL8(CLR_RGB32 *dst, uint8_t *src, uint32_t pixels, CLR_RGB32 *clut)
+	{
+	// Once the source is word aligned, read four indices per load
+	while (pixels != 0 && ((uint32_t) src & 3) != 0)
+		{
+		*dst++ = clut[*src++] ;
+		pixels-- ;
+		}
+
+	for (; pixels >= 4; pixels -= 4)
+		{
+		uint32_t quad = *(uint32_t *) src ;
+		dst[0] = clut[(quad >>  0) & 0xFF] ;
+		dst[1] = clut[(quad >>  8) & 0xFF] ;
+		dst[2] = clut[(quad >> 16) & 0xFF] ;
+		dst[3] = clut[(quad >> 24) & 0xFF] ;
+		src += 4 ;
+		dst += 4 ;
+		}
+
+	while (pixels-- != 0) *dst++ = clut[*src++] ;
+	}
+
+static void ConvertL4(CLR_RGB32 *dst, uint8_t *src, uint32_t phase, uint32_t pixels, CLR_RGB32 *clut)
+	{
+	// Two pixels per byte, low nibble first; phase 1 starts on the high nibble
+	if (phase != 0 && pixels != 0)
+		{
+		*dst++ = clut[*src++ >> 4] ;
+		pixels-- ;
+		}
+
+	for (; pixels >= 2; pixels -= 2)
+		{
+		uint32_t pair = *src++ ;
+		dst[0] = clut[pair & 0xF] ;
+		dst[1] = clut[pair >> 4] ;
+		dst += 2 ;
+		}
+
+	if (pixels != 0) *dst = clut[*src & 0xF] ;
+	}
+
+static void FillPixels(CLR_RGB32 *dst, CLR_RGB32 color, uint32_t pixels)
+	{
+	for (; pixels >= 4; pixels -= 4)
+		{
+		dst[0] = dst[1] = dst[2] = dst[3] = color ;
+		dst += 4 ;
+		}
+
+	while (pixels-- != 0) *dst++ = color ;
+	}
+
+static void ClearRect(FRAME frame_pixels, RECT *rect)
+	{
+	int xmin, xmax, ymin, ymax, y ;
+
+	xmin = MAX(rect->xmin, 0) ;
+	xmax = MIN(rect->xmax, FRAME_COLS - 1) ;
+	ymin = MAX(rect->ymin, 0) ;
+	ymax = MIN(rect->ymax, FRAME_ROWS - 1) ;
+	if (xmin > xmax) return ;
+
+	for (y = ymin; y <= ymax; y++)
+		{
+		FillSpan(frame_pixels[y], xmin, xmax - xmin + 1, CLR_INDEX_WHITE) ;
+		}
+	}
+
+static void EmptyRect(RECT *rect)
+	{
+	rect->xmin = rect->ymin = INT32_MAX ;
+	rect->xmax = rect->ymax = INT32_MIN ;
+	}
+
+static void ExtendRect(RECT *rect, int x, int y)
+	{
+	if (x < rect->xmin) rect->xmin = x ;
+	if (x > rect->xmax) rect->xmax = x ;
+	if (y < rect->ymin) rect->ymin = y ;
+	if (y > rect->ymax) rect->ymax = y ;
+	}
+
+static void UnionRect(RECT *dst, RECT *rect1, RECT *rect2)
+	{
+	dst->xmin = MIN(rect1->xmin, rect2->xmin) ;
+	dst->ymin = MIN(rect1->ymin, rect2->ymin) ;
+	dst->xmax = MAX(rect1->xmax, rect2->xmax) ;
+	dst->ymax = MAX(rect1->ymax, rect2->ymax) ;
 	}
 
 static void SanityCheck(void)
@@ -797,6 +1565,27 @@ static void DisplaySpeed(SLIDER *slider)
 	PutStringAt(xpos, slider->ymin - FONT_HEIGHT, text) ;
 	}
 
+static void DisplayTiming(TIMING *timing)
+	{
+	uint32_t render, stall, saved ;
+
+	render = timing->render / timing->frames ;
+	stall  = timing->stall  / timing->frames ;
+
+	// Share of a full-frame transfer the CPU no longer waits for. A
+	// frame sends only its damaged rect, usually much less than the
+	// full frame, so this is not how much of that frame's own transfer
+	// was hidden behind rendering.
+	saved = (stall < timing->xfer) ? 100 * (timing->xfer - stall) / timing->xfer : 0 ;
+
+	SetForeground(COLOR_BLACK) ;
+	SetBackground(COLOR_WHITE) ;
+	PutStringAt(TIMING_XPOS, TIMING_YPOS, "Render:%7u Stall:%7u", render, stall) ;
+	PutStringAt(TIMING_XPOS, TIMING_YPOS + FONT_HEIGHT, "Full xfer:%7u Saved:%3u%%", timing->xfer, saved) ;
+
+	timing->frames = timing->render = timing->stall = 0 ;
+	}
+
 static void InitSlider(SLIDER *slider)
 	{
 	float percent ;
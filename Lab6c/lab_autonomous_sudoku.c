@@ -22,19 +22,58 @@
 extern uint32_t	GetNibble(void *nibbles, uint32_t which) ;
 extern void		PutNibble(void *nibbles, uint32_t which, uint32_t value) ;
 
+// Whole-board kernels in lab_sudoku_bulk_src.s (8 cells per word)
+extern void		UnpackNibbles(const void *nibbles, uint8_t *bytes, uint32_t words) ;
+extern void		PackNibbles(const uint8_t *bytes, void *nibbles, uint32_t words) ;
+
 typedef struct
 	{
 	char *		status ;
+	char *		grade ;
 	unsigned	initial ;
 	unsigned	placed ;
 	unsigned	removed ;
-	unsigned	getCalls ;
+	unsigned	forced ;
+	unsigned	eliminated[5] ;	// INFERENCE: candidates removed, by technique
+	unsigned	avoided[5] ;	// INFERENCE: branch points removed, by technique
+	unsigned	nodes ;		// search calls made by the solver
+	unsigned	depth ;		// most decisions outstanding at once
+	unsigned	stack ;		// peak bytes of search stack
+	unsigned	memory ;	// solver tables plus peak stack, in bytes
+	unsigned	solveCycles ;	// elapsed less time spent redrawing
+	unsigned	displayCycles ;
+	unsigned	accessCycles ;	// SEARCH_PROFILE: writing cells during search
+	unsigned	checkCycles ;	// SEARCH_PROFILE: conflict checks & candidate pruning
+	unsigned	getCalls ;	// cells read from a packed board, by GetNibble or a bulk unpack
 	unsigned	putCalls ;
 	unsigned	getCycles ;
 	unsigned	putCycles ;
 	float		elapsed ;
 	} REPORT ;
 
+typedef struct
+	{
+	unsigned	puzzles ;
+	unsigned	solved ;
+	unsigned	nodes ;
+	unsigned	peak ;		// most memory any one puzzle needed
+	float		elapsed ;
+	unsigned	minimum ;	// solve cycles per puzzle
+	unsigned	mean ;
+	unsigned	maximum ;
+	unsigned	histogram[8] ;
+	} BATCH ;
+
+typedef struct
+	{
+	unsigned	nodes ;
+	unsigned	tries ;			// digits placed at this depth
+	unsigned	backtracks ;	// digits taken back at this depth
+	} DEPTH_PROFILE ;
+
+typedef struct _BOARD BOARD ;	// Search state of the bitboard solver
+typedef struct _SPLIT SPLIT ;	// Subtrees of one puzzle for SPLIT_DEPTH
+
 typedef struct _tFont
 	{
 	const uint8_t *table ;
@@ -49,20 +88,53 @@ extern sFONT Font20 ;
 extern sFONT Font24 ;	// Largest font used for game
 
 // Functions private to the main program
-static int		Cell2Fill(int index) ;
+static BOOL		BitboardPlace(BOARD *board, int index, int digit) ;
+static BOOL		BitboardPropagate(BOARD *board) ;
+static int		BitboardFewest(BOARD *board) ;
+static BOOL		BitboardInfer(BOARD *board, unsigned *used) ;
+static BOOL		BitboardLoad(BOARD *board, uint8_t *cells) ;
+static int		BitboardSearch(BOARD *board, int depth) ;
+static BOOL		BitboardSingles(BOARD *board) ;
+static void		BitboardUndo(BOARD *board, unsigned mark) ;
+static int		Cell2Fill(void) ;
+static int		CountSolutions(BOARD *board, int limit, uint32_t *first) ;
+static uint32_t	CellFlags(int row, int col) ;
 static void		ClearFlags(int row, int col, int digit) ;
 static BOOL		Conflict(int row, int col, int digit) ;
+static void		DisplayAdded(uint8_t *given) ;
+static void		DisplayBatch(BATCH *batch) ;
 static void		DisplayBoard(void) ;
 static void		DisplayCell(int row, int col, int digit) ;
+static void		DisplayInference(REPORT *report) ;
+static void		DisplayProfile(REPORT *report) ;
 static void		DisplayResults(REPORT *report) ;
+static void		DisplaySplit(SPLIT *split) ;
+static void		DlxBuild(void) ;
+static void		DlxCover(int column) ;
+static int		DlxSearch(int depth) ;
+static void		DlxUncover(int column) ;
 static void		DrawGrid(void) ;
 static void		EditConfiguration(void) ;
+static BOOL		Eliminate(BOARD *board, int index, uint32_t mask, int technique) ;
+static void		ExportProfile(REPORT *report) ;
+static void		GeneratePuzzle(void) ;
+static char *	GradePuzzle(void) ;
+static uint32_t	GetFiveBits(const void *cells, uint32_t which) ;
 static void		InitializeGame(void) ;
 static void		InitializeFlags(void) ;
 static void		InitializeStats(void) ;
 static void		InitializeTouchScreen(void) ;
+static void		InitializePlaces(BOARD *board) ;
+static void		InitializeUnits(void) ;
+static BOOL		InferIntersections(BOARD *board) ;
+static BOOL		InferPairs(BOARD *board) ;
+static BOOL		InferXWings(BOARD *board) ;
 static void		LEDs(int grn_on, int red_on) ;
+static void		LoadPuzzle(const char *text) ;
+static void		PackFiveBits(const uint8_t *bytes, void *cells) ;
+static void		PutFiveBits(void *cells, uint32_t which, uint32_t value) ;
 static void		RandomizeGame(void) ;
+static void		RefreshDisplay(BOOL now) ;
 static void		RandomizeMajor(void (*Swap)(int major1, int major2)) ;
 static void		RandomizeMinor(void (*Swap)(int minor1, int minor2)) ;
 static int		ReportHeader(int row, sFONT *font, char *text, int lines) ;
@@ -70,27 +142,110 @@ static int		ReportLine(int row, sFONT *font, char *fmt, ...) ;
 static int		SanityChecksOK(void) ;
 static void		SetFlags(int row, int col, int digit) ;
 static void		SetFontSize(sFONT *font) ;
+static void		Shuffle(uint8_t *items, int count) ;
+static void		ShowCell(int index, int digit, uint32_t color) ;
+static int		Solve(void) ;
+static void		SolveBatch(void) ;
+static int		SolveBitboard(void) ;
+static int		SolveDlx(void) ;
 static int		SolvePuzzle(int index, int count) ;
+static int		SolveSplit(void) ;
+static unsigned	SplitBoard(BOARD *board, int depth, unsigned room) ;
+static unsigned	SplitLatency(SPLIT *split, int workers) ;
 static void		SwapCols(int col1, int col2) ;
 static void		SwapRows(int row1, int row2) ;
+static void		TrackStack(int depth) ;
+static void		UnpackFiveBits(const void *cells, uint8_t *bytes) ;
+static BOOL		UserAbort(void) ;
+static void		UpdateCounts(int index, uint32_t bit, int delta) ;
 
 #define	TOP_EDGE	56
 #define	LFT_EDGE	10
 
-#define	ROWS		9
-#define	COLS		9
-#define	BLKS		9
+#define	BOX			3			// 3: 9x9, 4: 16x16, 5: 25x25
+#define	SIZE		(BOX*BOX)	// digits, and cells per row, col & blk
+
+#define	ROWS		SIZE
+#define	COLS		SIZE
+#define	BLKS		SIZE
 
 #define	CELLS		(ROWS*COLS)
-#define	WORDS		(CELLS + 7)/8
 
+// Cells are packed nibbles (GetNibble/PutNibble) while digits fit in
+// 4 bits. The larger boards pack 5-bit cells, 6 to a word so none
+// straddles two words; CELL_BITS 8 trades that for plain bytes.
+#if SIZE < 16
+#define	CELL_BITS	4
+#else
+#define	CELL_BITS	5			// 5 or 8
+#endif
+
+#if CELL_BITS == 4
+#define	GetCell(cells, which)			GetNibble(cells, which)
+#define	PutCell(cells, which, value)	PutNibble(cells, which, value)
+#define	UnpackCells(cells, bytes)		UnpackNibbles(cells, bytes, WORDS)
+#define	PackCells(bytes, cells)			PackNibbles(bytes, cells, WORDS)
+#elif CELL_BITS == 5
+#define	GetCell(cells, which)			GetFiveBits(cells, which)
+#define	PutCell(cells, which, value)	PutFiveBits(cells, which, value)
+#define	UnpackCells(cells, bytes)		UnpackFiveBits(cells, bytes)
+#define	PackCells(bytes, cells)			PackFiveBits(bytes, cells)
+#elif CELL_BITS == 8
+#define	GetCell(cells, which)			(((uint8_t *) (cells))[which])
+#define	PutCell(cells, which, value)	(((uint8_t *) (cells))[which] = (value))
+#define	UnpackCells(cells, bytes)		memcpy(bytes, cells, CELL_BYTES)
+#define	PackCells(bytes, cells)			memcpy(cells, bytes, CELL_BYTES)
+#else
+#error "CELL_BITS must be 4, 5 or 8"
+#endif
+
+#define	CELLS_PER_WORD	(32/CELL_BITS)
+#define	WORDS		((CELLS + CELLS_PER_WORD - 1)/CELLS_PER_WORD)
+#define	CELL_BYTES	(WORDS*CELLS_PER_WORD)	// unpacked board, one cell per byte
+
+// Candidate masks need bits 1..SIZE; board indices need CELLS values
+#if SIZE < 16
+typedef uint16_t	CANDIDATES ;
+#else
+typedef uint32_t	CANDIDATES ;
+#endif
+#if CELLS <= 256
+typedef uint8_t		CELL_INDEX ;
+#else
+typedef uint16_t	CELL_INDEX ;
+#endif
+
+// Cell size in pixels follows the font that still fits SIZE cells across
+#if BOX == 3
+#define	CELL_FONT	Font24
 #define	CELL_HEIGHT	25
 #define	CELL_WIDTH	23
-
-#define	HORZ_OFFSET	(LFT_EDGE + 3)
+#define	CHAR_XOFS	3
+#elif BOX == 4
+#define	CELL_FONT	Font12
+#define	CELL_HEIGHT	13
+#define	CELL_WIDTH	13
+#define	CHAR_XOFS	3
+#elif BOX == 5
+#define	CELL_FONT	Font8
+#define	CELL_HEIGHT	9
+#define	CELL_WIDTH	7
+#define	CHAR_XOFS	1
+#else
+#error "BOX must be 3, 4 or 5"
+#endif
+
+#define	HORZ_OFFSET	(LFT_EDGE + CHAR_XOFS)
 #define	VERT_OFFSET	(TOP_EDGE + 1)
 
+// Pixel offset of a cell, and of the grid line before it, from the
+// board's corner: thin lines are 1 pixel, block edges 2.
+#define	CELL_PXL(n)		((n) + (n)/BOX + 2)
+#define	LINE_PXL(n)		((n) + ((n) + BOX - 1)/BOX)
+
 #define	INDEX(row, col)	((row)*COLS+(col))
+#define	BLOCK(row, col)	(BOX*((row)/BOX) + (col)/BOX)
+#define	KIND(unit)		(((unit) < ROWS) ? 0 : ((unit) < ROWS + COLS) ? 1 : 2)	// cell_units[][] slot
 #define	ENTRIES(a)		(sizeof(a)/sizeof(a[0]))
 
 #define	REPORT_XPOS		20
@@ -99,20 +254,247 @@ static void		SwapRows(int row1, int row2) ;
 
 #define	EMPTY		0
 
+#define	SOLVER_BACKTRACK	0	// SolvePuzzle: recursive backtracking; 9x9 only
+#define	SOLVER_BITBOARD		1	// SolveBitboard: candidate masks with propagation
+#define	SOLVER_DLX			2	// SolveDlx: exact cover with dancing links
+#define	SOLVER				SOLVER_BITBOARD
+
+#if SOLVER == SOLVER_BACKTRACK && BOX != 3
+#error "SOLVER_BACKTRACK does not finish 16x16 puzzles (no solution after 14M nodes)"
+#endif
+
+#define	BATCH_MODE		0	// 1: solve all of puzzles[] headless and report throughput
+#define	BATCH_GENERATED	2000	// more puzzles from GeneratePuzzle, solved after puzzles[]
+#define	BATCH_PUZZLES	(ENTRIES(puzzles) + BATCH_GENERATED)
+#define	BATCH_SLOWEST	8	// puzzles kept in batch_slowest[] for the debugger
+#define	LATENCY_BASE	14	// first histogram bin: under 2^14 cycles
+#define	CYCLES_PER_SEC	168000000
+
+#define	GENERATE_PUZZLES	0	// 1: new random puzzle each game instead of shuffling initial[]
+#define	GRADE_MEDIUM		10	// most search nodes for a "Medium" puzzle
+#define	DIG_NODES			2000	// search nodes allowed to prove a new hole keeps the puzzle unique
+
+#define	FAST_SOLVE		0	// 1: solver only marks cells dirty; redraw at REFRESH_HZ
+#define	REFRESH_HZ		20
+#define	POLL_NODES		256	// fast mode checks for abort & redraw this often
+
+#define	SEARCH_PROFILE	0	// 1: per-depth counts and a cycle split, shown and exported as CSV
+#define	PROFILE_LINES	12	// depths listed on screen; the CSV has all of them
+#define	CSV_PRINTF		0	// 1: also printf the CSV (needs stdout retargeted)
+#define	CSV_BYTES		(128 + 40*(CELLS + 1))	// room for every count at 10 digits
+
+#define	INFERENCE		0	// 1: bitboard solver also applies pairs, pointing/claiming & X-wings
+#define	NAKED_PAIRS		0	// indices of report.eliminated[] and avoided[]
+#define	HIDDEN_PAIRS	1
+#define	POINTING		2
+#define	CLAIMING		3
+#define	X_WINGS			4
+
+#define	SPLIT_DEPTH		0	// >0: bitboard search cut into subtrees this deep to estimate parallel speedup
+#define	SPLIT_TASKS		64	// most subtrees; shallower cuts are made to stay under it
+#define	SPLIT_WORKERS	8	// largest worker count simulated
+
+#define	UNITS		(ROWS + COLS + BLKS)
+#define	PEERS		(2*(SIZE - 1) + (BOX - 1)*(BOX - 1))	// cells sharing a row, col or blk
+#define	ALL_DIGITS	((CANDIDATES) ((1UL << (SIZE + 1)) - 2))	// bits 1 through SIZE
+
+// Exact cover matrix: one column per constraint (cell filled, and digit
+// present in each row, col & blk); one matrix row per digit per cell.
+#define	DLX_COLUMNS	(4*CELLS)
+#define	DLX_ROWS	(SIZE*CELLS)
+#define	DLX_NODES	(1 + DLX_COLUMNS + 4*DLX_ROWS)	// root, headers, 1's
+
+typedef struct
+	{
+	uint16_t	left, right, up, down ;	// pool indices, not pointers
+	uint16_t	column ;				// header of this node's column
+	uint16_t	row ;					// SIZE*cell + digit - 1
+	} DLX_NODE ;
+
+// One entry of SolvePuzzle's decision stack
+typedef struct
+	{
+	CELL_INDEX	index ;		// cell being filled
+	uint8_t		digit ;		// digit now in it; EMPTY before the first try
+	} DECISION ;
+
+struct _BOARD
+	{
+	uint32_t	packed[WORDS] ;		// same format as storage
+	CANDIDATES	candidates[CELLS] ;	// bit d set: digit d still possible
+	CANDIDATES	placed[UNITS] ;		// digits already in each row, col & blk
+	int			filled ;
+	} ;
+
+// Undo trail of the bitboard engine. Each entry is one candidate bit
+// taken from a cell, pushed before the change, so a search level puts
+// its changes back by popping to where it started instead of searching
+// a copy of the BOARD. A path takes each bit at most once, so the trail
+// never holds more entries than an empty board has candidate bits.
+#define	TRAIL_ENTRIES	(CELLS*SIZE)
+#define	TRAIL(index, digit, placed)	((index) << 6 | (digit) << 1 | (placed))	// placed: the digit went in the cell
+
+// Independent subtrees of one puzzle, each searched and timed alone
+struct _SPLIT
+	{
+	unsigned	tasks ;
+	unsigned	serial ;				// cycles spent cutting the tree
+	unsigned	cycles[SPLIT_TASKS] ;	// to search the subtree, or to its solution
+	uint8_t		depth[SPLIT_TASKS] ;
+	BOOL		solved[SPLIT_TASKS] ;
+	} ;
+
+// One BATCH_MODE puzzle: the work it took and the grid it ended with
+typedef struct
+	{
+	unsigned	puzzle ;	// order solved, from 0
+	unsigned	nodes ;
+	unsigned	cycles ;
+	uint32_t	solution[WORDS] ;	// same format as storage
+	} BATCH_RECORD ;
+
+#if INFERENCE && SOLVER != SOLVER_BITBOARD
+#error "INFERENCE needs SOLVER_BITBOARD"
+#endif
+#if SPLIT_DEPTH && SOLVER != SOLVER_BITBOARD
+#error "SPLIT_DEPTH needs SOLVER_BITBOARD"
+#endif
+#if SPLIT_DEPTH && BOX == 5
+#error "SPLIT_DEPTH's task boards only fit in RAM up to 16x16"
+#endif
+
 static uint32_t storage[WORDS] ;
+#if BOX == 3
 static uint32_t initial[WORDS] =
 	{
 	0x00900001, 0x02003007, 0x00060009, 0x03080100, 0x09009070,
 	0x10200801, 0x05050400, 0x00010000, 0x00500209, 0x00005006,
 	0x00000003
 	} ;
+#else
+static uint32_t initial[WORDS] ;	// filled in by GeneratePuzzle
+#if !GENERATE_PUZZLES
+#error "only 9x9 has a built-in puzzle; set GENERATE_PUZZLES"
+#endif
+#endif
 static REPORT report ;
+static BOOL headless ;		// no display updates or abort checks while solving
+static uint32_t dirty[(CELLS + 31)/32] ;	// cells changed since last redraw
+
+// Labels for report.eliminated[] and avoided[]
+static const char * const technique[] =
+	{
+	"Naked pr", "Hidden pr", "Pointing", "Claiming", "X-wing"
+	} ;
+
+// Digits as shown and as written in puzzle text
+static const char symbols[] = ".123456789ABCDEFGHIJKLMNOP" ;
+
+// Puzzle set for BATCH_MODE, one 81-character line per puzzle ('.' = empty)
+#if BOX == 3
+static const char * const puzzles[] =
+	{
+	"1....9..7..3..2.9...6.....1.8.3..7.9..9.1.8..2.1..4.5.5.....1...9.2..5..6..5....3",
+	"8..........36......7..9.2...5...7.......457.....1...3...1....68..85...1..9....4..",
+	"4.....8.5.3..........7......2.....6.....8.4......1.......6.3.7.5..2.....1.4......",
+	"...9.2........15.712.....692..3...7...8.......965.....86..7...24.9..5.135..8.9...",
+	".59...36....13.........785.5...2..3...8......2.1.8.59..2.318....4.7....96........",
+	"64.8....2.831.....5...6.....9.....4.....5.1.6..7...2.....64....86......9..4..3.7.",
+	".....38..8......1.34.....6..796.......3..5.......4.27..2.4.86......5...3....7...5",
+	"3.9.........3..9..8..1..62..7......2.3.....6.1..42.7.....5.4..6.5...93.77.4...258",
+	".9.3..14.1.......7....2.36...52.8...6...1..3..8.7.3...9.1.......2....45..4..9...2",
+	".8.....1.3.....9..214..9....2..8..93..7....5.8...6........3......6....28...4.1.35",
+	"..8.6.....57.....26.9.8..5....7.8.19...12.........43.7...9.26........4.198.......",
+	"..........481.5.3.....92..7156....8..94..6.1....9.4.....5.783..4.9.......13...57.",
+	"..8.21.4.5.378....7.4...............2.....356.59...28.9.5.4..1..........3..5..968",
+	"..47.2.51.......3....5....7.1.....8...21.4....5.8...6......5.....3..79..28.4..7..",
+	"8..29......48.....1....5.493.8.7.1........5....2.8.7.......8..1.7...943.....1...2",
+	"3.8.5...29.......54...89...731............27..5..7.6185.3.2.7..19.4...8......6...",
+	"..3.69.......8..7.5..7...6.7...1..5...24....79.8..2.4.......12.21.8..5..8...5....",
+	".7..9.6....2....8.......7.3....5.26....18......637..51.2.4.....7.1.6...9......832",
+	"..32.1.9.9...4.1...5...9....2.7.5.....58....21...3...88....7.54......8.6..6...7..",
+	".74.32.91......6.4.1.....27...5...892.347.....5...1.........9164.1..6.32.........",
+	".7.25..9.....981..5..1.3.....7...93.6........3......4.48...5..3..1.4.8...3.8....6",
+	"...87...4....5...84......1...7.2....954.........78...37..1.6.5.56..479...1.......",
+	".6......7.2.8...3.1.879.6.4..6..2.8..5.18.4........................2.96394...7...",
+	"..51.3..........124.....53.6..7.....342...8......5..6.126....58.8...2.967...6...3",
+	"59....2.7....7.6....2...............1..4..9...2..3.14..7.264.9.4.59..3.2.....1.8.",
+	".3..5.67....6...5..2...8.1.3.49....5..1.3..2.........4...8.6...5..4..268.........",
+	"6.1.4..98.............6.2.4...8...399.........2...6...2...38...3.....72.7..59..1.",
+	"...9435.1....1.......8...3.96...427..1..7.36......6.1...2.3......76..193..9....5.",
+	"..2.7.5....839..61.3........9.417.....6.....9....56.7.8.17........8.....459...2..",
+	"......4....174...2.......85...1.....4..89.....29476....6...85.3..82..9...5....8..",
+	"..7..4.8...1......6..18.....2.........49.7..1....56.....853...6.1.6..45.5..4..7..",
+	"..6......2.......6981........7.85.3..1...962....76.8...7.9.8..313.47.2.9......5.."
+	} ;
+#else
+static const char * const puzzles[] = { NULL } ;
+#if BATCH_MODE
+#error "puzzles[] is only provided for 9x9"
+#endif
+#endif
 
 #define	FLAGS_ROWS	0
 #define	FLAGS_COLS	1
 #define	FLAGS_BLKS	2
 
-static uint32_t flags[3][9] ;
+static uint32_t flags[3][SIZE] ;
+
+// Legal digits left in each cell, kept current by SetFlags and ClearFlags
+#define	FILLED		64			// added once a cell holds a digit
+static uint8_t	counts[CELLS] ;
+
+// At most one decision per empty cell, so the search never needs more
+static DECISION	decisions[CELLS] ;
+
+// CountSolutions gives up (reports limit) once report.nodes passes this; 0: never
+static uint32_t	count_limit ;
+
+// SEARCH_PROFILE counters, indexed by search depth, and the CSV made
+// from them; read profile_csv out with the debugger after a solve.
+static DEPTH_PROFILE	profile[SEARCH_PROFILE ? CELLS + 1 : 1] ;
+static char				profile_csv[SEARCH_PROFILE ? CSV_BYTES : 1] ;
+static unsigned			clock_overhead ;	// cycles to read the cycle counter
+
+// The BATCH_MODE puzzles that took longest, slowest first; read them
+// out with the debugger after a batch.
+static BATCH_RECORD		batch_slowest[BATCH_SLOWEST] ;
+
+// INFERENCE: bit k of places[unit][digit] set if the unit's k-th cell
+// could take the digit. Rebuilt before each round of techniques; going
+// stale as they remove candidates is safe, since every deduction made
+// from a superset of the places still holds for the subset.
+static uint32_t	places[UNITS][SIZE + 1] ;
+
+// Bitboard undo trail; trail_top is the next free entry
+static uint16_t	trail[TRAIL_ENTRIES] ;
+static unsigned	trail_top ;
+
+// SPLIT_DEPTH subtrees, with their starting boards
+static SPLIT	split ;
+static BOARD	split_boards[SPLIT_DEPTH ? SPLIT_TASKS : 1] ;
+
+// Cell indices of every row, column & block, and of each cell's peers
+static CELL_INDEX	units[UNITS][SIZE] ;
+static uint8_t		cell_units[CELLS][3] ;
+static CELL_INDEX	peers[CELLS][PEERS] ;
+
+// Dancing links pool; node 0 is the root, 1..DLX_COLUMNS the headers.
+// Only 9x9 fits in RAM (16x16 would need over 200K), so the pool is
+// allocated only when SOLVER_DLX is chosen.
+#if SOLVER == SOLVER_DLX
+#if BOX != 3
+#error "SOLVER_DLX only fits in RAM for 9x9"
+#endif
+static DLX_NODE	dlx[DLX_NODES] ;
+static uint8_t	dlx_size[1 + DLX_COLUMNS] ;
+#else
+static DLX_NODE	dlx[1] ;
+static uint8_t	dlx_size[1] ;
+#endif
+static uint16_t	dlx_chosen[CELLS] ;
+
+static uintptr_t stack_low ;	// lowest stack address seen while solving
 static uint32_t	digit_foreground ;
 static uint32_t digit_background ;
 
@@ -122,27 +504,39 @@ int main()
 	InitializeTouchScreen() ;
 
 	if (!SanityChecksOK()) return 255 ;
+	InitializeUnits() ;
 
 	while (1)
 		{
 		unsigned cells_filled, strt, stop ;
 
+		if (BATCH_MODE)
+			{
+			SolveBatch() ;
+			WaitForPushButton() ;
+			continue ;
+			}
+
+		if (GENERATE_PUZZLES) GeneratePuzzle() ;
+		else RandomizeGame() ;
+
 		InitializeStats() ;
-		RandomizeGame() ;
 		DisplayBoard() ;
 		InitializeFlags() ;
 		InitializeGame() ;
 		EditConfiguration() ;
 
 		WaitForPushButton() ;	// Wait for user to start the algorithm
+		report.grade = GradePuzzle() ;	// the board as edited
 
 		digit_foreground = COLOR_BLUE ;
 		digit_background = COLOR_WHITE ;
 
 		strt = GetClockCycleCount() ;
-		cells_filled = SolvePuzzle(0, report.initial) ;
+		cells_filled = Solve() ;
 		stop = GetClockCycleCount() ;
-		report.elapsed = (stop - strt) / 168000000.0 ;
+		report.elapsed = (stop - strt) / (float) CYCLES_PER_SEC ;
+		report.solveCycles = stop - strt - report.displayCycles ;
 
 		if (cells_filled < CELLS)
 			{
@@ -157,6 +551,25 @@ int main()
 
 		DisplayResults(&report) ;
 		WaitForPushButton() ;
+
+		if (SEARCH_PROFILE)
+			{
+			ExportProfile(&report) ;
+			DisplayProfile(&report) ;
+			WaitForPushButton() ;
+			}
+
+		if (SPLIT_DEPTH)
+			{
+			DisplaySplit(&split) ;
+			WaitForPushButton() ;
+			}
+
+		if (INFERENCE)
+			{
+			DisplayInference(&report) ;
+			WaitForPushButton() ;
+			}
 		}
 
 	return 0 ;
@@ -197,10 +610,12 @@ static void InitializeStats(void)
 	unsigned strt, stop, ovhd ;
 
 	memset(&report, 0, sizeof(report)) ;
+	memset(profile, 0, sizeof(profile)) ;
 
 	strt = GetClockCycleCount() ;
 	stop = GetClockCycleCount() ;
 	ovhd = stop - strt ;
+	clock_overhead = ovhd ;
 
 	strt = GetClockCycleCount() ;
 	GetNibble(storage, 0) ;
@@ -241,7 +656,7 @@ static int ReportLine(int row, sFONT *font, char *format, ...)
 
 static void DisplayResults(REPORT *report)
 	{
-	sFONT *font = &Font16 ;
+	sFONT *font = &Font12 ;
 	int row ;
 
 	ClearDisplay() ;
@@ -249,30 +664,196 @@ static void DisplayResults(REPORT *report)
 
 	row = REPORT_YPOS ;
 
-	row = ReportHeader(row, font, "PUZZLE RESULTS", 2) ;
+	row = ReportHeader(row, font, "PUZZLE RESULTS", 4) ;
 	row = ReportLine(row, font, "   Status:%s", report->status) ;
+	row = ReportLine(row, font, "    Grade:%s", report->grade) ;
 	row = ReportLine(row, font, "  Elapsed:%.2fs", report->elapsed) ;
+	row = ReportLine(row, font, "  Solving:%.2fs", report->solveCycles / (float) CYCLES_PER_SEC) ;
 
-	row += 6 ;
+	row += 2 ;
 
-	row = ReportHeader(row, font, "DIGIT PLACEMENTS", 3) ;
+	row = ReportHeader(row, font, "DIGIT PLACEMENTS", 4) ;
 	row = ReportLine(row, font, "  Initial:%u", report->initial) ;
 	row = ReportLine(row, font, " Attempts:%u", report->placed) ;
 	row = ReportLine(row, font, " Removals:%u", report->removed) ;
+	row = ReportLine(row, font, "   Forced:%u", report->forced) ;
 
-	row += 6 ;
+	row += 2 ;
 
 	row = ReportHeader(row, font, "FUNCTION CALLS", 2) ;
 	row = ReportLine(row, font, "GetNibble:%u", report->getCalls) ;
 	row = ReportLine(row, font, "PutNibble:%u", report->putCalls) ;
 
-	row += 6 ;
+	row += 2 ;
+
+	row = ReportHeader(row, font, "SEARCH", 3) ;
+	row = ReportLine(row, font, "    Nodes:%u", report->nodes) ;
+	row = ReportLine(row, font, "Max depth:%u", report->depth) ;
+	row = ReportLine(row, font, "    Stack:%uB", report->stack) ;
+
+	row += 2 ;
 
 	row = ReportHeader(row, font, "CLOCK CYCLES", 2) ;
 	row = ReportLine(row, font, "GetNibble:%u", report->getCycles) ;
 	row = ReportLine(row, font, "PutNibble:%u", report->putCycles) ;
 	}
 
+static void DisplayBatch(BATCH *batch)
+	{
+	sFONT *font = &Font12 ;
+	float msec = 1000.0 / CYCLES_PER_SEC ;
+	int row, bin ;
+
+	ClearDisplay() ;
+	SetFontSize(font) ;
+
+	row = REPORT_YPOS ;
+
+	row = ReportHeader(row, font, "BATCH RESULTS", 6) ;
+	row = ReportLine(row, font, "  Puzzles:%u", batch->puzzles) ;
+	row = ReportLine(row, font, "   Solved:%u", batch->solved) ;
+	row = ReportLine(row, font, "    Nodes:%u", batch->nodes) ;
+	row = ReportLine(row, font, " Peak mem:%u", batch->peak) ;
+	row = ReportLine(row, font, "  Elapsed:%.3fs", batch->elapsed) ;
+	row = ReportLine(row, font, " Per sec.:%.1f", batch->puzzles / batch->elapsed) ;
+
+	row += 6 ;
+
+	row = ReportHeader(row, font, "SOLVE TIME (ms)", 3) ;
+	row = ReportLine(row, font, "  Minimum:%.3f", batch->minimum * msec) ;
+	row = ReportLine(row, font, "     Mean:%.3f", batch->mean * msec) ;
+	row = ReportLine(row, font, "  Maximum:%.3f", batch->maximum * msec) ;
+
+	row += 6 ;
+
+	row = ReportHeader(row, font, "HISTOGRAM (ms)", ENTRIES(batch->histogram)) ;
+	for (bin = 0; bin < ENTRIES(batch->histogram) - 1; bin++)
+		{
+		row = ReportLine(row, font, "  <%6.2f:%u", (1 << (LATENCY_BASE + bin)) * msec, batch->histogram[bin]) ;
+		}
+	row = ReportLine(row, font, " >=%6.2f:%u", (1 << (LATENCY_BASE + bin - 1)) * msec, batch->histogram[bin]) ;
+	}
+
+static void DisplayProfile(REPORT *report)
+	{
+	sFONT *font = &Font12 ;
+	float percent = 100.0 / (report->solveCycles + report->displayCycles) ;
+	unsigned other = report->solveCycles - report->accessCycles - report->checkCycles ;
+	BOOL shown[ENTRIES(profile)] ;
+	int row, lines, depth ;
+
+	ClearDisplay() ;
+	SetFontSize(font) ;
+
+	row = REPORT_YPOS ;
+
+	row = ReportHeader(row, font, "CYCLE SPLIT (%)", 5) ;
+	row = ReportLine(row, font, "   Access:%.1f", report->accessCycles * percent) ;
+	row = ReportLine(row, font, "   Checks:%.1f", report->checkCycles * percent) ;
+	row = ReportLine(row, font, "  Display:%.1f", report->displayCycles * percent) ;
+	row = ReportLine(row, font, "   Search:%.1f", other * percent) ;
+	row = ReportLine(row, font, " Cyc/node:%u", report->solveCycles / (report->nodes | 1)) ;
+
+	row += 6 ;
+
+	// The busiest depths, listed in depth order
+	memset(shown, FALSE, sizeof(shown)) ;
+	for (lines = 0; lines < PROFILE_LINES; lines++)
+		{
+		int busiest = -1 ;
+		for (depth = 0; depth < ENTRIES(profile); depth++)
+			{
+			if (shown[depth] || profile[depth].nodes == 0) continue ;
+			if (busiest < 0 || profile[depth].nodes > profile[busiest].nodes) busiest = depth ;
+			}
+		if (busiest < 0) break ;
+		shown[busiest] = TRUE ;
+		}
+
+	row = ReportHeader(row, font, "Dep  Nodes  Backs", lines) ;
+	for (depth = 0; depth < ENTRIES(profile); depth++)
+		{
+		if (!shown[depth]) continue ;
+		row = ReportLine(row, font, "%3d%7u%7u", depth, profile[depth].nodes, profile[depth].backtracks) ;
+		}
+	}
+
+static void DisplayInference(REPORT *report)
+	{
+	sFONT *font = &Font12 ;
+	int row ;
+
+	ClearDisplay() ;
+	SetFontSize(font) ;
+
+	row = REPORT_YPOS ;
+
+	row = ReportHeader(row, font, "ELIMINATIONS", ENTRIES(technique)) ;
+	for (int k = 0; k < ENTRIES(technique); k++)
+		{
+		row = ReportLine(row, font, "%9s:%u", technique[k], report->eliminated[k]) ;
+		}
+
+	row += 6 ;
+
+	row = ReportHeader(row, font, "BRANCHES CUT", ENTRIES(technique)) ;
+	for (int k = 0; k < ENTRIES(technique); k++)
+		{
+		row = ReportLine(row, font, "%9s:%u", technique[k], report->avoided[k]) ;
+		}
+
+	row += 6 ;
+
+	row = ReportHeader(row, font, "SEARCH", 2) ;
+	row = ReportLine(row, font, "   Forced:%u", report->forced) ;
+	row = ReportLine(row, font, "    Nodes:%u", report->nodes) ;
+	}
+
+static void DisplaySplit(SPLIT *split)
+	{
+	sFONT *font = &Font12 ;
+	unsigned serial = SplitLatency(split, 1) ;
+	int row, lines, workers ;
+
+	ClearDisplay() ;
+	SetFontSize(font) ;
+
+	row = REPORT_YPOS ;
+
+	row = ReportHeader(row, font, "SPLIT SEARCH", 3) ;
+	row = ReportLine(row, font, "    Tasks:%u", split->tasks) ;
+	row = ReportLine(row, font, " Split at:%d", SPLIT_DEPTH) ;
+	row = ReportLine(row, font, "   Serial:%.2fms", serial * 1000.0 / CYCLES_PER_SEC) ;
+
+	row += 6 ;
+
+	for (lines = 0, workers = 1; workers <= SPLIT_WORKERS; workers *= 2) lines++ ;
+	row = ReportHeader(row, font, "Workers  Speedup", lines) ;
+	for (workers = 1; workers <= SPLIT_WORKERS; workers *= 2)
+		{
+		row = ReportLine(row, font, "%7d%9.2f", workers, serial / (float) SplitLatency(split, workers)) ;
+		}
+	}
+
+static void ExportProfile(REPORT *report)
+	{
+	// Totals line, then one line per depth reached
+	char *csv = profile_csv ;
+	char *end = profile_csv + sizeof(profile_csv) ;
+
+	csv += snprintf(csv, end - csv, "nodes,solve,access,checks,display\n%u,%u,%u,%u,%u\n",
+		report->nodes, report->solveCycles, report->accessCycles, report->checkCycles, report->displayCycles) ;
+	csv += snprintf(csv, end - csv, "depth,nodes,tries,backtracks\n") ;
+	for (int depth = 0; depth < ENTRIES(profile); depth++)
+		{
+		if (profile[depth].nodes == 0) continue ;
+		csv += snprintf(csv, end - csv, "%d,%u,%u,%u\n", depth,
+			profile[depth].nodes, profile[depth].tries, profile[depth].backtracks) ;
+		}
+
+	if (CSV_PRINTF) fputs(profile_csv, stdout) ;
+	}
+
 static void SetFontSize(sFONT *font)
 	{
 	extern void BSP_LCD_SetFont(sFONT *) ;
@@ -287,162 +868,1077 @@ static void InitializeGame(void)
 		}
 	}
 
-static int SolvePuzzle(int index, int cells_filled)
+static int Solve(void)
 	{
-	int row, col ;
+	uint8_t top ;
+	int cells_filled ;
 
-	// Check for user abort
-	if (PushButtonPressed())
+	stack_low = (uintptr_t) &top ;
+	report.stack = 0 ;
+	memset(dirty, 0, sizeof(dirty)) ;
+	switch (SOLVER)
 		{
-		WaitForPushButton() ;
-		return CELLS + 1 ;
+		case SOLVER_BITBOARD:
+			cells_filled = SPLIT_DEPTH ? SolveSplit() : SolveBitboard() ;
+			report.memory = sizeof(units) + sizeof(cell_units) + sizeof(peers) + sizeof(BOARD) + sizeof(trail) ;
+			if (SPLIT_DEPTH) report.memory += sizeof(split_boards) ;
+			break ;
+		case SOLVER_DLX:
+			cells_filled = SolveDlx() ;
+			report.memory = sizeof(dlx) + sizeof(dlx_size) + sizeof(dlx_chosen) ;
+			break ;
+		default:
+			cells_filled = SolvePuzzle(Cell2Fill(), report.initial) ;
+			report.memory = sizeof(flags) + sizeof(counts) + sizeof(peers) ;
+			report.stack = report.depth * sizeof(DECISION) ;
+			break ;
 		}
+	report.stack += (uintptr_t) &top - stack_low ;
+	report.memory += report.stack ;
+	if (FAST_SOLVE && !headless) RefreshDisplay(TRUE) ;
+	return cells_filled ;
+	}
 
-	if (cells_filled >= CELLS)
+static BOOL UserAbort(void)
+	{
+	// Normally the button is polled at every search node; fast mode
+	// polls (and redraws dirty cells) only every POLL_NODES nodes.
+	if (headless) return FALSE ;
+	if (FAST_SOLVE)
 		{
-		return cells_filled ;
+		if (report.nodes % POLL_NODES != 0) return FALSE ;
+		RefreshDisplay(FALSE) ;
 		}
+	if (!PushButtonPressed()) return FALSE ;
+	WaitForPushButton() ;
+	return TRUE ;
+	}
+
+static void ShowCell(int index, int digit, uint32_t color)
+	{
+	unsigned strt ;
 
-	report.getCalls++ ;
-    if (GetNibble(storage, index) != EMPTY)
+	if (headless) return ;
+	if (FAST_SOLVE)
 		{
-		cells_filled = SolvePuzzle(Cell2Fill(index), cells_filled) ;
-		return cells_filled ;
+		dirty[index / 32] |= 1 << (index % 32) ;
+		return ;
 		}
+	strt = GetClockCycleCount() ;
+	SetColor(color) ;
+	DisplayCell(index / COLS, index % COLS, digit) ;
+	report.displayCycles += GetClockCycleCount() - strt ;
+	}
+
+static void RefreshDisplay(BOOL now)
+	{
+	// Redraws the cells marked dirty, at most REFRESH_HZ times a second
+	// unless told to do it now.
+	static unsigned last ;
+	unsigned strt, stop ;
 
-    /*
-     * Iterate through the possible digits for this empty cell
-     * and recurse for every valid one, to test if it's part
-     * of the valid solution.
-     */
-	row = index / ROWS ;
-	col = index % COLS ;
+	strt = GetClockCycleCount() ;
+	if (!now && strt - last < CYCLES_PER_SEC / REFRESH_HZ) return ;
 
-	for (int digit = 1; digit <= 9; digit++)
+	for (int word = 0; word < ENTRIES(dirty); word++)
 		{
-		int new_filled ;
+		while (dirty[word] != 0)
+			{
+			int index = 32*word + __builtin_ctz(dirty[word]) ;
 
-		if (Conflict(row, col, digit)) continue ;
+			dirty[word] &= dirty[word] - 1 ;
+			DisplayCell(index / COLS, index % COLS, GetCell(storage, index)) ;
+			report.getCalls++ ;
+			}
+		}
 
-		SetColor(COLOR_RED) ;
-		PutNibble(storage, index, digit) ;
-		DisplayCell(row, col, digit) ;
+	stop = GetClockCycleCount() ;
+	report.displayCycles += stop - strt ;
+	last = stop ;
+	}
+
+static void TrackStack(int depth)
+	{
+	// The stack grows down; called at each search node
+	uint8_t here ;
+	if ((uintptr_t) &here < stack_low) stack_low = (uintptr_t) &here ;
+	if (depth > report.depth) report.depth = depth ;
+	if (SEARCH_PROFILE) profile[depth].nodes++ ;
+	}
+
+static void SolveBatch(void)
+	{
+	// Solve puzzles[], then BATCH_GENERATED new puzzles, back to back
+	// with the display left alone. Statistics are kept as each puzzle
+	// is solved, so the count is not limited by RAM; the slowest few
+	// go to batch_slowest[]. The screen shows puzzles per second and
+	// how solve time spreads. Generating is not counted.
+	BATCH batch ;
+	uint64_t total ;
+
+	InitializeStats() ;
+	memset(&batch, 0, sizeof(batch)) ;
+	memset(batch_slowest, 0, sizeof(batch_slowest)) ;
+	batch.puzzles = BATCH_PUZZLES ;
+	batch.minimum = 0xFFFFFFFF ;
+	total = 0 ;
+
+	headless = TRUE ;
+	for (int k = 0; k < BATCH_PUZZLES; k++)
+		{
+		unsigned before, after, cycles, nodes, bin ;
+		int slot ;
+
+		if (k < ENTRIES(puzzles)) LoadPuzzle(puzzles[k]) ;
+		else
+			{
+			REPORT saved = report ;
+			GeneratePuzzle() ;
+			report = saved ;
+			}
+		report.initial = 0 ;	// counted per puzzle by InitializeFlags
+		InitializeFlags() ;
+		InitializeGame() ;
+
+		nodes = report.nodes ;
+		before = GetClockCycleCount() ;
+		if (Solve() == CELLS) batch.solved++ ;
+		after = GetClockCycleCount() ;
+		cycles = after - before ;
+		total += cycles ;
+		if (cycles < batch.minimum) batch.minimum = cycles ;
+		if (cycles > batch.maximum) batch.maximum = cycles ;
+		if (report.memory > batch.peak) batch.peak = report.memory ;
+
+		// bin b holds times under 2^(LATENCY_BASE + b) cycles
+		bin = 32 - __builtin_clz(cycles | 1) ;
+		bin = (bin > LATENCY_BASE) ? bin - LATENCY_BASE : 0 ;
+		if (bin >= ENTRIES(batch.histogram)) bin = ENTRIES(batch.histogram) - 1 ;
+		batch.histogram[bin]++ ;
+
+		// Slower than one kept: shift the faster ones down a slot
+		for (slot = BATCH_SLOWEST; slot > 0 && cycles > batch_slowest[slot - 1].cycles; slot--)
+			{
+			if (slot < BATCH_SLOWEST) batch_slowest[slot] = batch_slowest[slot - 1] ;
+			}
+		if (slot < BATCH_SLOWEST)
+			{
+			BATCH_RECORD *record = &batch_slowest[slot] ;
+			record->puzzle = k ;
+			record->nodes = report.nodes - nodes ;
+			record->cycles = cycles ;
+			memcpy(record->solution, storage, sizeof(storage)) ;
+			}
+		}
+	headless = FALSE ;
+	batch.nodes = report.nodes ;
+	batch.mean = total / BATCH_PUZZLES ;
+	report.solveCycles = total ;
+	if (SEARCH_PROFILE) ExportProfile(&report) ;
+
+	batch.elapsed = total / (float) CYCLES_PER_SEC ;
+
+	DisplayBatch(&batch) ;
+	}
+
+static void LoadPuzzle(const char *text)
+	{
+	uint8_t cells[CELL_BYTES] ;
+
+	// A short line leaves the rest empty; an unknown character is empty too
+	memset(cells, EMPTY, sizeof(cells)) ;
+	for (int index = 0; index < CELLS && text[index] != '\0'; index++)
+		{
+		const char *symbol = strchr(symbols, text[index]) ;
+		if (symbol != NULL && symbol - symbols <= SIZE) cells[index] = symbol - symbols ;
+		}
+	PackCells(cells, initial) ;
+	}
+
+static int SolvePuzzle(int index, int cells_filled)
+	{
+	// Depth-first search without recursion: each decisions[] entry is
+	// a cell being filled and the digit it holds, so stepping to the
+	// next digit or backtracking is a loop iteration, not a call.
+	// index must be an empty cell.
+	DECISION *top = decisions ;
+	unsigned strt ;
+
+	if (cells_filled >= CELLS) return cells_filled ;
+
+	top->index = index ;
+	top->digit = EMPTY ;
+
+	while (1)
+		{
+		int row = top->index / COLS ;
+		int col = top->index % COLS ;
+		int digit ;
+
+		// First visit to this node?
+		if (top->digit == EMPTY)
+			{
+			if (UserAbort()) return CELLS + 1 ;
+			report.nodes++ ;
+			TrackStack(top - decisions + 1) ;
+			}
+		else
+			{
+			ClearFlags(row, col, top->digit) ;
+			cells_filled-- ;
+			}
+
+		if (SEARCH_PROFILE) strt = GetClockCycleCount() ;
+		digit = top->digit + 1 ;
+		while (digit <= SIZE && Conflict(row, col, digit)) digit++ ;
+		if (SEARCH_PROFILE) report.checkCycles += GetClockCycleCount() - strt - clock_overhead ;
+
+		if (digit > SIZE)
+			{
+			// Out of digits: empty the cell and back up a level
+			if (SEARCH_PROFILE) strt = GetClockCycleCount() ;
+			PutCell(storage, top->index, EMPTY) ;
+			if (SEARCH_PROFILE) report.accessCycles += GetClockCycleCount() - strt - clock_overhead ;
+			ShowCell(top->index, EMPTY, COLOR_RED) ;
+			report.removed++ ;
+			report.putCalls++ ;
+			if (SEARCH_PROFILE) profile[top - decisions + 1].backtracks++ ;
+			if (top == decisions) return cells_filled ;
+			top-- ;
+			continue ;
+			}
+
+		top->digit = digit ;
+		if (SEARCH_PROFILE) strt = GetClockCycleCount() ;
+		PutCell(storage, top->index, digit) ;
+		if (SEARCH_PROFILE) report.accessCycles += GetClockCycleCount() - strt - clock_overhead ;
+		ShowCell(top->index, digit, COLOR_RED) ;
 		SetFlags(row, col, digit) ;
 		report.placed++ ;
 		report.putCalls++ ;
+		if (SEARCH_PROFILE) profile[top - decisions + 1].tries++ ;
 
-		new_filled = SolvePuzzle(Cell2Fill(index), cells_filled + 1) ;
-		if (new_filled >= CELLS)
+		if (++cells_filled == CELLS)
 			{
-			SetColor(COLOR_BLUE) ;
-			DisplayCell(row, col, digit) ;
-			return new_filled ;
+			for (; top >= decisions; top--) ShowCell(top->index, top->digit, COLOR_BLUE) ;
+			return cells_filled ;
 			}
 
-		ClearFlags(row, col, digit) ;
+		top++ ;
+		top->index = Cell2Fill() ;
+		top->digit = EMPTY ;
 		}
+	}
 
-	PutNibble(storage, index, EMPTY) ;
-	DisplayCell(row, col, EMPTY) ;
-	report.removed++ ;
-	report.putCalls++ ;
+static int SolveBitboard(void)
+	{
+	// Same inputs and results as SolvePuzzle, but search is done on
+	// per-cell candidate masks, and naked and hidden singles are
+	// filled in after every placement before branching again.
+	static BOARD board ;
+	uint8_t given[CELL_BYTES] ;
+	int cells_filled ;
+
+	UnpackCells(storage, given) ;
+	report.getCalls += CELLS ;
+	if (!BitboardLoad(&board, given)) return 0 ;
+
+	cells_filled = BitboardSearch(&board, 0) ;
+	if (cells_filled == CELLS && !headless) DisplayAdded(given) ;
 	return cells_filled ;
 	}
 
-static void DisplayCell(int row, int col, int digit)
+static void DisplayAdded(uint8_t *given)
 	{
-	static int pxlrow[] =
+	// The solution is now in storage; show what was added
+	uint8_t cells[CELL_BYTES] ;
+	unsigned strt ;
+
+	strt = GetClockCycleCount() ;
+	UnpackCells(storage, cells) ;
+	SetColor(COLOR_BLUE) ;
+	for (int index = 0; index < CELLS; index++)
 		{
-		 2 + 0*CELL_HEIGHT,  3 + 1*CELL_HEIGHT,  4 + 2*CELL_HEIGHT,
-		 6 + 3*CELL_HEIGHT,  7 + 4*CELL_HEIGHT,  8 + 5*CELL_HEIGHT,
-		10 + 6*CELL_HEIGHT, 11 + 7*CELL_HEIGHT, 12 + 8*CELL_HEIGHT
-		} ;
-	static int pxlcol[] =
+		if (given[index] != EMPTY) continue ;
+		DisplayCell(index / COLS, index % COLS, cells[index]) ;
+		}
+	report.displayCycles += GetClockCycleCount() - strt ;
+	}
+
+static int SolveSplit(void)
+	{
+	// There's one core, so the subtrees are searched one after another;
+	// their times then drive a simulated pool of workers (SplitLatency).
+	// Every subtree is searched, even after a solution, since a pool
+	// would have had some of them running alongside it.
+	static BOARD board ;
+	uint32_t solution[WORDS] ;
+	uint8_t given[CELL_BYTES] ;
+	unsigned strt, stop, mark ;
+	int found = 0 ;
+
+	memset(&split, 0, sizeof(split)) ;
+	UnpackCells(storage, given) ;
+	report.getCalls += CELLS ;
+	if (!BitboardLoad(&board, given)) return 0 ;
+
+	strt = GetClockCycleCount() ;
+	SplitBoard(&board, 0, SPLIT_TASKS) ;
+	stop = GetClockCycleCount() ;
+	split.serial = stop - strt ;
+
+	mark = trail_top ;
+	for (int k = 0; k < split.tasks; k++)
 		{
-		 2 + 0*CELL_WIDTH,  3 + 1*CELL_WIDTH,  4 + 2*CELL_WIDTH,
-		 6 + 3*CELL_WIDTH,  7 + 4*CELL_WIDTH,  8 + 5*CELL_WIDTH,
-		10 + 6*CELL_WIDTH, 11 + 7*CELL_WIDTH, 12 + 8*CELL_WIDTH
+		int cells_filled ;
+
+		trail_top = mark ;	// a solved task leaves its path on the trail
+		strt = GetClockCycleCount() ;
+		cells_filled = BitboardSearch(&split_boards[k], split.depth[k]) ;
+		stop = GetClockCycleCount() ;
+		split.cycles[k] = stop - strt ;
+
+		if (cells_filled > CELLS) return cells_filled ;
+		if (cells_filled < CELLS) continue ;
+		split.solved[k] = TRUE ;
+		if (found++ == 0) memcpy(solution, storage, sizeof(solution)) ;
+		}
+
+	if (found == 0) return board.filled ;
+	memcpy(storage, solution, sizeof(solution)) ;
+	if (!headless) DisplayAdded(given) ;
+	return CELLS ;
+	}
+
+static unsigned SplitBoard(BOARD *board, int depth, unsigned room)
+	{
+	// Adds the subtrees under board as tasks, using at most room of
+	// them, and returns how many it used. A board becomes a task of its
+	// own at SPLIT_DEPTH, or sooner if its children wouldn't fit.
+	CANDIDATES candidates ;
+	unsigned used, mark ;
+	int index, children ;
+
+	if (!BitboardPropagate(board)) return 0 ;
+
+	index = BitboardFewest(board) ;
+	candidates = (board->filled < CELLS) ? board->candidates[index] : 0 ;
+	children = __builtin_popcount(candidates) ;
+	if (depth == SPLIT_DEPTH || children == 0 || children > room)
+		{
+		split_boards[split.tasks] = *board ;
+		split.depth[split.tasks++] = depth ;
+		return 1 ;
+		}
+
+	used = 0 ;
+	mark = trail_top ;
+	while (candidates != 0)
+		{
+		int digit = __builtin_ctz(candidates) ;
+
+		candidates &= candidates - 1 ;
+		children-- ;
+		if (BitboardPlace(board, index, digit))
+			{
+			used += SplitBoard(board, depth + 1, room - used - children) ;	// leave one for each later sibling
+			}
+		BitboardUndo(board, mark) ;
+		}
+	return used ;
+	}
+
+static unsigned SplitLatency(SPLIT *split, int workers)
+	{
+	// List scheduling, as a shared queue of subtrees would behave: each
+	// task goes to the first worker free, and the first solution found
+	// cancels everything still running or queued.
+	unsigned busy[SPLIT_WORKERS] ;
+	unsigned latency = 0xFFFFFFFF, finish = 0 ;
+
+	memset(busy, 0, sizeof(busy)) ;
+	for (int k = 0; k < split->tasks; k++)
+		{
+		int worker = 0 ;
+
+		for (int w = 1; w < workers; w++)
+			{
+			if (busy[w] < busy[worker]) worker = w ;
+			}
+		if (busy[worker] >= latency) break ;
+
+		busy[worker] += split->cycles[k] ;
+		if (busy[worker] > finish) finish = busy[worker] ;
+		if (split->solved[k] && busy[worker] < latency) latency = busy[worker] ;
+		}
+
+	// No solution: done when the last worker finishes
+	if (latency == 0xFFFFFFFF) latency = finish ;
+	return split->serial + latency ;
+	}
+
+static int BitboardSearch(BOARD *board, int depth)
+	{
+	// Changes made here stay on the board, and on the trail, until the
+	// caller takes them back.
+	CANDIDATES candidates ;
+	unsigned strt, mark ;
+	BOOL consistent ;
+	int index ;
+
+	// Check for user abort
+	if (UserAbort()) return CELLS + 1 ;
+
+	report.nodes++ ;
+	TrackStack(depth) ;
+
+	if (SEARCH_PROFILE) strt = GetClockCycleCount() ;
+	consistent = BitboardPropagate(board) ;
+	if (SEARCH_PROFILE) report.checkCycles += GetClockCycleCount() - strt - clock_overhead ;
+	if (!consistent) return board->filled ;
+
+	if (board->filled == CELLS)
+		{
+		memcpy(storage, board->packed, sizeof(board->packed)) ;
+		return CELLS ;
+		}
+
+	index = BitboardFewest(board) ;
+	candidates = board->candidates[index] ;
+	mark = trail_top ;
+	while (candidates != 0)
+		{
+		int digit = __builtin_ctz(candidates) ;
+		int cells_filled ;
+
+		candidates &= candidates - 1 ;
+		report.placed++ ;
+		if (SEARCH_PROFILE) profile[depth].tries++ ;
+		if (SEARCH_PROFILE) strt = GetClockCycleCount() ;
+		consistent = BitboardPlace(board, index, digit) ;
+		if (SEARCH_PROFILE) report.checkCycles += GetClockCycleCount() - strt - clock_overhead ;
+		if (consistent)
+			{
+			cells_filled = BitboardSearch(board, depth + 1) ;
+			if (cells_filled >= CELLS) return cells_filled ;
+			}
+		if (SEARCH_PROFILE) strt = GetClockCycleCount() ;
+		BitboardUndo(board, mark) ;
+		if (SEARCH_PROFILE) report.checkCycles += GetClockCycleCount() - strt - clock_overhead ;
+		report.removed++ ;
+		if (SEARCH_PROFILE) profile[depth].backtracks++ ;
+		}
+
+	return board->filled ;
+	}
+
+static BOOL BitboardLoad(BOARD *board, uint8_t *cells)
+	{
+	// Returns FALSE if the given digits conflict. Starts a new trail;
+	// the givens' entries stay at its bottom.
+	trail_top = 0 ;
+	memset(board, 0, sizeof(BOARD)) ;
+	for (int index = 0; index < CELLS; index++) board->candidates[index] = ALL_DIGITS ;
+
+	for (int index = 0; index < CELLS; index++)
+		{
+		int digit = cells[index] ;
+		if (digit != EMPTY && !BitboardPlace(board, index, digit)) return FALSE ;
+		}
+	return TRUE ;
+	}
+
+static int BitboardFewest(BOARD *board)
+	{
+	// The empty cell with the fewest candidates, to branch on
+	int fewest = 0 ;
+
+	for (int index = 0; index < CELLS; index++)
+		{
+		CANDIDATES candidates = board->candidates[index] ;
+		if (candidates == 0) continue ;
+		if (fewest == 0 || __builtin_popcount(candidates) < __builtin_popcount(board->candidates[fewest - 1]))
+			{
+			fewest = index + 1 ;
+			}
+		}
+	return fewest - 1 ;
+	}
+
+static BOOL BitboardPlace(BOARD *board, int index, int digit)
+	{
+	// Returns FALSE if the placement leaves a peer with no candidates
+	CANDIDATES bit = 1 << digit ;
+	CANDIDATES left ;
+	CELL_INDEX *peer ;
+	int k ;
+
+	if ((board->candidates[index] & bit) == 0) return FALSE ;
+
+	PutCell(board->packed, index, digit) ;
+	report.putCalls++ ;
+	for (left = board->candidates[index]; left != 0; left &= left - 1)
+		{
+		int other = __builtin_ctz(left) ;
+		trail[trail_top++] = TRAIL(index, other, other == digit) ;
+		}
+	board->candidates[index] = 0 ;
+	board->filled++ ;
+	for (k = 0; k < 3; k++) board->placed[cell_units[index][k]] |= bit ;
+
+	peer = peers[index] ;
+	for (k = 0; k < PEERS; k++, peer++)
+		{
+		if ((board->candidates[*peer] & bit) == 0) continue ;
+		trail[trail_top++] = TRAIL(*peer, digit, 0) ;
+		board->candidates[*peer] &= ~bit ;
+		if (board->candidates[*peer] == 0) return FALSE ;
+		}
+	return TRUE ;
+	}
+
+static void BitboardUndo(BOARD *board, unsigned mark)
+	{
+	// Pops the trail back to mark. packed is left alone: a digit there
+	// is stale until its cell is placed again, and a solution has every
+	// cell placed.
+	while (trail_top > mark)
+		{
+		unsigned entry = trail[--trail_top] ;
+		int index = entry >> 6 ;
+		CANDIDATES bit = 1 << ((entry >> 1) & 0x1F) ;
+
+		board->candidates[index] |= bit ;
+		if ((entry & 1) == 0) continue ;
+		for (int k = 0; k < 3; k++) board->placed[cell_units[index][k]] &= ~bit ;
+		board->filled-- ;
+		}
+	}
+
+static BOOL BitboardPropagate(BOARD *board)
+	{
+	// Fills singles until there are none. With INFERENCE, the techniques
+	// then get a turn, and singles another, until neither changes
+	// anything. Returns FALSE on a contradiction.
+	//
+	// A technique removes a branch point when the cell the search would
+	// have branched on gets filled, or a contradiction turns up, before
+	// singles run out again. report.avoided[] counts those for each
+	// technique that removed candidates in that round.
+	unsigned used = 0 ;
+	int target = 0 ;
+	BOOL consistent = TRUE ;
+
+	do
+		{
+		if (consistent) consistent = BitboardSingles(board) ;
+		for (; used != 0; used &= used - 1)
+			{
+			if (!consistent || board->candidates[target] == 0) report.avoided[__builtin_ctz(used)]++ ;
+			}
+		if (!consistent || !INFERENCE || board->filled == CELLS) return consistent ;
+
+		target = BitboardFewest(board) ;
+		consistent = BitboardInfer(board, &used) ;
+		} while (used != 0) ;
+
+	return consistent ;
+	}
+
+static BOOL BitboardSingles(BOARD *board)
+	{
+	// Fill naked singles (one candidate left in a cell) and hidden
+	// singles (one cell left for a digit in a unit) until there are
+	// none; returns FALSE on a contradiction.
+	BOOL changed ;
+
+	do
+		{
+		changed = FALSE ;
+
+		for (int index = 0; index < CELLS; index++)
+			{
+			CANDIDATES candidates = board->candidates[index] ;
+			if (candidates == 0 || (candidates & (candidates - 1)) != 0) continue ;
+			if (!BitboardPlace(board, index, __builtin_ctz(candidates))) return FALSE ;
+			report.forced++ ;
+			changed = TRUE ;
+			}
+
+		for (int unit = 0; unit < UNITS; unit++)
+			{
+			CANDIDATES once = 0, twice = 0, single ;
+			CELL_INDEX *cell = units[unit] ;
+
+			for (int k = 0; k < SIZE; k++)
+				{
+				twice |= once & board->candidates[cell[k]] ;
+				once  |= board->candidates[cell[k]] ;
+				}
+			if ((once | board->placed[unit]) != ALL_DIGITS) return FALSE ;
+
+			for (single = once & ~twice; single != 0; single &= single - 1)
+				{
+				int digit = __builtin_ctz(single) ;
+				int k = 0 ;
+
+				// A cell that was the only place for two digits is now gone
+				while (k < SIZE && (board->candidates[cell[k]] & (1 << digit)) == 0) k++ ;
+				if (k == SIZE || !BitboardPlace(board, cell[k], digit)) return FALSE ;
+				report.forced++ ;
+				changed = TRUE ;
+				}
+			}
+		} while (changed) ;
+
+	return TRUE ;
+	}
+
+static BOOL BitboardInfer(BOARD *board, unsigned *used)
+	{
+	// Applies the techniques cheapest first, stopping at the first that
+	// removes anything so singles get another look. used gets bit k set
+	// if report.eliminated[k] grew; FALSE on a contradiction.
+	static BOOL (* const Infer[])(BOARD *board) =
+		{
+		InferPairs, InferIntersections, InferXWings
 		} ;
+	unsigned before[ENTRIES(report.eliminated)] ;
+	BOOL consistent = TRUE ;
+
+	memcpy(before, report.eliminated, sizeof(before)) ;
+	InitializePlaces(board) ;
+	*used = 0 ;
+	for (int k = 0; k < ENTRIES(Infer) && *used == 0 && consistent; k++)
+		{
+		consistent = (*Infer[k])(board) ;
+		for (int t = 0; t < ENTRIES(before); t++)
+			{
+			if (report.eliminated[t] != before[t]) *used |= 1 << t ;
+			}
+		}
+	return consistent ;
+	}
+
+static BOOL InferPairs(BOARD *board)
+	{
+	// Naked pair: two cells of a unit down to the same two candidates
+	// take those digits from the rest of the unit. Hidden pair: two
+	// digits open in the same two cells only clear the rest of those
+	// cells.
+	for (int unit = 0; unit < UNITS; unit++)
+		{
+		CELL_INDEX *cell = units[unit] ;
+		uint32_t *place = places[unit] ;
+
+		for (int i = 0; i < SIZE; i++)
+			{
+			CANDIDATES pair = board->candidates[cell[i]] ;
+			if (__builtin_popcount(pair) != 2) continue ;
+			for (int j = i + 1; j < SIZE; j++)
+				{
+				if (board->candidates[cell[j]] != pair) continue ;
+				for (int k = 0; k < SIZE; k++)
+					{
+					if (k == i || k == j) continue ;
+					if (!Eliminate(board, cell[k], pair, NAKED_PAIRS)) return FALSE ;
+					}
+				}
+			}
+
+		for (int d1 = 1; d1 <= SIZE; d1++)
+			{
+			if (__builtin_popcount(place[d1]) != 2) continue ;
+			for (int d2 = d1 + 1; d2 <= SIZE; d2++)
+				{
+				CANDIDATES pair = (1 << d1) | (1 << d2) ;
+				if (place[d2] != place[d1]) continue ;
+				if (!Eliminate(board, cell[__builtin_ctz(place[d1])], ~pair, HIDDEN_PAIRS)) return FALSE ;
+				if (!Eliminate(board, cell[31 - __builtin_clz(place[d1])], ~pair, HIDDEN_PAIRS)) return FALSE ;
+				}
+			}
+		}
+	return TRUE ;
+	}
+
+static BOOL InferIntersections(BOARD *board)
+	{
+	// Pointing: a digit whose places in a blk all lie on one row or col
+	// is cleared from the rest of that line. Claiming: places in a row
+	// or col all inside one blk clear the digit from the rest of the blk.
+	for (int unit = 0; unit < UNITS; unit++)
+		{
+		CELL_INDEX *cell = units[unit] ;
+
+		for (int digit = 1; digit <= SIZE; digit++)
+			{
+			CANDIDATES bit = 1 << digit ;
+			uint32_t place = places[unit][digit] ;
+			int first ;
+
+			if (__builtin_popcount(place) < 2) continue ;
+			first = cell[__builtin_ctz(place)] ;
+
+			for (int kind = 0; kind < 3; kind++)
+				{
+				int other = cell_units[first][kind] ;
+				uint32_t left ;
+
+				if (kind == KIND(unit)) continue ;
+				if (kind != 2 && KIND(unit) != 2) continue ;	// a row and a col share one cell
+
+				for (left = place; left != 0; left &= left - 1)
+					{
+					if (cell_units[cell[__builtin_ctz(left)]][kind] != other) break ;
+					}
+				if (left != 0) continue ;
+
+				// All places are where unit meets other
+				for (int k = 0; k < SIZE; k++)
+					{
+					int index = units[other][k] ;
+					if (cell_units[index][KIND(unit)] == unit) continue ;
+					if (!Eliminate(board, index, bit, (kind == 2) ? CLAIMING : POINTING)) return FALSE ;
+					}
+				}
+			}
+		}
+	return TRUE ;
+	}
+
+static BOOL InferXWings(BOARD *board)
+	{
+	// Two rows whose only places for a digit are the same two cols: the
+	// digit must go in those cols on those rows, so the rest of both
+	// cols lose it. Likewise with rows and cols swapped.
+	for (int digit = 1; digit <= SIZE; digit++)
+		{
+		CANDIDATES bit = 1 << digit ;
+
+		for (int base = 0; base < ROWS + COLS; base += ROWS)
+			{
+			int cross = ROWS - base ;	// first unit of the other kind
+
+			for (int l1 = 0; l1 < SIZE; l1++)
+				{
+				uint32_t place = places[base + l1][digit] ;
+
+				if (__builtin_popcount(place) != 2) continue ;
+				for (int l2 = l1 + 1; l2 < SIZE; l2++)
+					{
+					if (places[base + l2][digit] != place) continue ;
+					for (uint32_t left = place; left != 0; left &= left - 1)
+						{
+						CELL_INDEX *cell = units[cross + __builtin_ctz(left)] ;
+						for (int k = 0; k < SIZE; k++)
+							{
+							if (k == l1 || k == l2) continue ;
+							if (!Eliminate(board, cell[k], bit, X_WINGS)) return FALSE ;
+							}
+						}
+					}
+				}
+			}
+		}
+	return TRUE ;
+	}
+
+static void InitializePlaces(BOARD *board)
+	{
+	memset(places, 0, sizeof(places)) ;
+	for (int unit = 0; unit < UNITS; unit++)
+		{
+		for (int k = 0; k < SIZE; k++)
+			{
+			CANDIDATES candidates = board->candidates[units[unit][k]] ;
+			for (; candidates != 0; candidates &= candidates - 1)
+				{
+				places[unit][__builtin_ctz(candidates)] |= 1 << k ;
+				}
+			}
+		}
+	}
+
+static BOOL Eliminate(BOARD *board, int index, uint32_t mask, int technique)
+	{
+	// Returns FALSE if the cell is left with no candidates
+	CANDIDATES removed = board->candidates[index] & mask ;
+
+	if (removed == 0) return TRUE ;
+	for (CANDIDATES left = removed; left != 0; left &= left - 1)
+		{
+		trail[trail_top++] = TRAIL(index, __builtin_ctz(left), 0) ;
+		}
+	board->candidates[index] &= ~mask ;
+	report.eliminated[technique] += __builtin_popcount(removed) ;
+	return board->candidates[index] != 0 ;
+	}
+
+static int SolveDlx(void)
+	{
+	// Knuth's Algorithm X: the givens select their rows up front, then
+	// the search picks the column with the fewest rows left each time.
+	// The givens are already in storage, so only the search's choices
+	// go in dlx_chosen[], and depth counts search levels alone.
+	uint8_t given[CELL_BYTES] ;
+	int index, cells_filled, givens ;
+
+	UnpackCells(storage, given) ;
+	report.getCalls += CELLS ;
+	DlxBuild() ;
+
+	givens = 0 ;
+	for (index = 0; index < CELLS; index++)
+		{
+		int digit = given[index] ;
+		int node, column ;
+
+		if (digit == EMPTY) continue ;
+
+		// The row is gone from the cell's column if an earlier given
+		// conflicts with it (LoadPuzzle and GeneratePuzzle don't check)
+		column = 1 + index ;
+		for (node = dlx[column].down; node != column; node = dlx[node].down)
+			{
+			if (dlx[node].row == SIZE*index + digit - 1) break ;
+			}
+		if (node == column) return 0 ;
+
+		DlxCover(column) ;
+		for (int j = dlx[node].right; j != node; j = dlx[j].right) DlxCover(dlx[j].column) ;
+		givens++ ;
+		}
+
+	cells_filled = DlxSearch(0) ;
+	if (cells_filled < CELLS) return givens ;
+	if (cells_filled == CELLS && !headless) DisplayAdded(given) ;
+	return cells_filled ;
+	}
+
+static void DlxBuild(void)
+	{
+	int column, node ;
+
+	// Root and column headers form one circular list
+	for (column = 0; column <= DLX_COLUMNS; column++)
+		{
+		dlx[column].left   = (column == 0) ? DLX_COLUMNS : column - 1 ;
+		dlx[column].right  = (column == DLX_COLUMNS) ? 0 : column + 1 ;
+		dlx[column].up     = column ;
+		dlx[column].down   = column ;
+		dlx[column].column = column ;
+		dlx_size[column]   = 0 ;
+		}
+
+	node = 1 + DLX_COLUMNS ;
+	for (int row = 0; row < DLX_ROWS; row++)
+		{
+		int cell  = row / SIZE ;
+		int digit = row % SIZE ;
+		int r = cell / COLS ;
+		int c = cell % COLS ;
+		int columns[4] ;
+
+		columns[0] = 1 + cell ;
+		columns[1] = 1 + 1*CELLS + SIZE*r + digit ;
+		columns[2] = 1 + 2*CELLS + SIZE*c + digit ;
+		columns[3] = 1 + 3*CELLS + SIZE*BLOCK(r, c) + digit ;
+
+		for (int k = 0; k < 4; k++, node++)
+			{
+			column = columns[k] ;
+			dlx[node].row    = row ;
+			dlx[node].column = column ;
+			dlx[node].left   = (k == 0) ? node + 3 : node - 1 ;
+			dlx[node].right  = (k == 3) ? node - 3 : node + 1 ;
+			dlx[node].down   = column ;
+			dlx[node].up     = dlx[column].up ;
+			dlx[dlx[column].up].down = node ;
+			dlx[column].up   = node ;
+			dlx_size[column]++ ;
+			}
+		}
+	}
+
+static void DlxCover(int column)
+	{
+	dlx[dlx[column].right].left = dlx[column].left ;
+	dlx[dlx[column].left].right = dlx[column].right ;
+	for (int i = dlx[column].down; i != column; i = dlx[i].down)
+		{
+		for (int j = dlx[i].right; j != i; j = dlx[j].right)
+			{
+			dlx[dlx[j].down].up = dlx[j].up ;
+			dlx[dlx[j].up].down = dlx[j].down ;
+			dlx_size[dlx[j].column]-- ;
+			}
+		}
+	}
+
+static void DlxUncover(int column)
+	{
+	for (int i = dlx[column].up; i != column; i = dlx[i].up)
+		{
+		for (int j = dlx[i].left; j != i; j = dlx[j].left)
+			{
+			dlx_size[dlx[j].column]++ ;
+			dlx[dlx[j].down].up = j ;
+			dlx[dlx[j].up].down = j ;
+			}
+		}
+	dlx[dlx[column].right].left = column ;
+	dlx[dlx[column].left].right = column ;
+	}
+
+static int DlxSearch(int depth)
+	{
+	int column, best ;
+	unsigned strt ;
+
+	// Check for user abort
+	if (UserAbort()) return CELLS + 1 ;
+
+	report.nodes++ ;
+	TrackStack(depth) ;
+
+	// All constraints met: every cell has exactly one digit
+	if (dlx[0].right == 0)
+		{
+		if (SEARCH_PROFILE) strt = GetClockCycleCount() ;
+		for (int k = 0; k < depth; k++)
+			{
+			PutCell(storage, dlx_chosen[k] / SIZE, dlx_chosen[k] % SIZE + 1) ;
+			report.putCalls++ ;
+			}
+		if (SEARCH_PROFILE) report.accessCycles += GetClockCycleCount() - strt - clock_overhead ;
+		return CELLS ;
+		}
+
+	best = dlx[0].right ;
+	for (column = dlx[best].right; column != 0; column = dlx[column].right)
+		{
+		if (dlx_size[column] < dlx_size[best]) best = column ;
+		}
+	if (dlx_size[best] == 0) return depth ;
+
+	DlxCover(best) ;
+	for (int i = dlx[best].down; i != best; i = dlx[i].down)
+		{
+		int cells_filled ;
+
+		dlx_chosen[depth] = dlx[i].row ;
+		report.placed++ ;
+		if (SEARCH_PROFILE) profile[depth].tries++ ;
+		if (SEARCH_PROFILE) strt = GetClockCycleCount() ;
+		for (int j = dlx[i].right; j != i; j = dlx[j].right) DlxCover(dlx[j].column) ;
+		if (SEARCH_PROFILE) report.checkCycles += GetClockCycleCount() - strt - clock_overhead ;
+
+		cells_filled = DlxSearch(depth + 1) ;
+		if (cells_filled >= CELLS) return cells_filled ;
+
+		if (SEARCH_PROFILE) strt = GetClockCycleCount() ;
+		for (int j = dlx[i].left; j != i; j = dlx[j].left) DlxUncover(dlx[j].column) ;
+		if (SEARCH_PROFILE) report.checkCycles += GetClockCycleCount() - strt - clock_overhead ;
+		report.removed++ ;
+		if (SEARCH_PROFILE) profile[depth].backtracks++ ;
+		}
+	DlxUncover(best) ;
+
+	return depth ;
+	}
+
+static void InitializeUnits(void)
+	{
+	for (int index = 0; index < CELLS; index++)
+		{
+		int row = index / COLS ;
+		int col = index % COLS ;
+		int blk = BLOCK(row, col) ;
+		int pos = BOX*(row%BOX) + col%BOX ;
+		int count = 0 ;
+
+		units[row][col] = index ;
+		units[ROWS + col][row] = index ;
+		units[ROWS + COLS + blk][pos] = index ;
+
+		cell_units[index][0] = row ;
+		cell_units[index][1] = ROWS + col ;
+		cell_units[index][2] = ROWS + COLS + blk ;
+
+		for (int other = 0; other < CELLS; other++)
+			{
+			int r = other / COLS ;
+			int c = other % COLS ;
+			if (other == index) continue ;
+			if (r == row || c == col || BLOCK(r, c) == blk) peers[index][count++] = other ;
+			}
+		}
+	}
+
+static void DisplayCell(int row, int col, int digit)
+	{
+	int pxlrow = CELL_PXL(row) + row*CELL_HEIGHT ;
+	int pxlcol = CELL_PXL(col) + col*CELL_WIDTH ;
 
 	if (digit == EMPTY)
 		{
 		SetForeground(COLOR_WHITE) ;
-		FillRect(pxlcol[col] + HORZ_OFFSET - 3, pxlrow[row] + VERT_OFFSET - 1, Font24.Width + 6, Font24.Height + 1) ;
+		FillRect(pxlcol + LFT_EDGE, pxlrow + TOP_EDGE, CELL_WIDTH, CELL_HEIGHT) ;
 		}
 	else
 		{
 		SetForeground(digit_background) ;
-		FillRect(pxlcol[col] + HORZ_OFFSET - 3, pxlrow[row] + VERT_OFFSET - 1, Font24.Width + 6, Font24.Height + 1) ;
+		FillRect(pxlcol + LFT_EDGE, pxlrow + TOP_EDGE, CELL_WIDTH, CELL_HEIGHT) ;
 		SetForeground(digit_foreground) ;
 		SetBackground(digit_background) ;
-		DisplayChar(pxlcol[col] + HORZ_OFFSET, pxlrow[row] + VERT_OFFSET, digit + '0') ;
+		DisplayChar(pxlcol + HORZ_OFFSET, pxlrow + VERT_OFFSET, symbols[digit]) ;
 		}
 	}
 
 static void DisplayBoard(void)
 	{
+	uint8_t cells[CELL_BYTES] ;
+
+	UnpackCells(initial, cells) ;
 	ClearDisplay() ;
 	DrawGrid() ;
-	SetFontSize(&Font24) ;
+	SetFontSize(&CELL_FONT) ;
 	digit_foreground = COLOR_BLACK ;
 	digit_background = COLOR_LIGHTGRAY ;
 	for (int row = 0; row < ROWS; row++)
 		{
 		for (int col = 0; col < COLS; col++)
 			{
-			DisplayCell(row, col, GetNibble(initial, INDEX(row, col))) ;
+			DisplayCell(row, col, cells[INDEX(row, col)]) ;
 			}
 		}
 	}
 
 static void DrawGrid(void)
 	{
-	typedef struct { int r, c, w, h ;} LINE ;
-	static LINE line[] =
-		{
-		{ 0 + 0*CELL_HEIGHT, 0, 14 + COLS*CELL_WIDTH, 2},
-		{ 2 + 1*CELL_HEIGHT, 0, 14 + COLS*CELL_WIDTH, 1},
-		{ 3 + 2*CELL_HEIGHT, 0, 14 + COLS*CELL_WIDTH, 1},
-		{ 4 + 3*CELL_HEIGHT, 0, 14 + COLS*CELL_WIDTH, 2},
-		{ 6 + 4*CELL_HEIGHT, 0, 14 + COLS*CELL_WIDTH, 1},
-		{ 7 + 5*CELL_HEIGHT, 0, 14 + COLS*CELL_WIDTH, 1},
-		{ 8 + 6*CELL_HEIGHT, 0, 14 + COLS*CELL_WIDTH, 2},
-		{10 + 7*CELL_HEIGHT, 0, 14 + COLS*CELL_WIDTH, 1},
-		{11 + 8*CELL_HEIGHT, 0, 14 + COLS*CELL_WIDTH, 1},
-		{12 + 9*CELL_HEIGHT, 0, 14 + COLS*CELL_WIDTH, 2},
-
-		{0,  0 + 0*CELL_WIDTH, 2, 14 + ROWS*CELL_HEIGHT},
-		{0,  2 + 1*CELL_WIDTH, 1, 14 + ROWS*CELL_HEIGHT},
-		{0,  3 + 2*CELL_WIDTH, 1, 14 + ROWS*CELL_HEIGHT},
-		{0,  4 + 3*CELL_WIDTH, 2, 14 + ROWS*CELL_HEIGHT},
-		{0,  6 + 4*CELL_WIDTH, 1, 14 + ROWS*CELL_HEIGHT},
-		{0,  7 + 5*CELL_WIDTH, 1, 14 + ROWS*CELL_HEIGHT},
-		{0,  8 + 6*CELL_WIDTH, 2, 14 + ROWS*CELL_HEIGHT},
-		{0, 10 + 7*CELL_WIDTH, 1, 14 + ROWS*CELL_HEIGHT},
-		{0, 11 + 8*CELL_WIDTH, 1, 14 + ROWS*CELL_HEIGHT},
-		{0, 12 + 9*CELL_WIDTH, 2, 14 + ROWS*CELL_HEIGHT},
-		} ;
-	LINE *l = line ;
+	int width  = LINE_PXL(COLS) + 2 + COLS*CELL_WIDTH ;
+	int height = LINE_PXL(ROWS) + 2 + ROWS*CELL_HEIGHT ;
 
 	SetColor(COLOR_BLACK) ;
-	for (int which = 0; which < ENTRIES(line); which++, l++)
+	for (int k = 0; k <= SIZE; k++)
 		{
-		FillRect(l->c + LFT_EDGE, l->r + TOP_EDGE, l->w, l->h) ;
+		int thick = (k % BOX == 0) ? 2 : 1 ;
+		FillRect(LFT_EDGE, LINE_PXL(k) + k*CELL_HEIGHT + TOP_EDGE, width, thick) ;
+		FillRect(LINE_PXL(k) + k*CELL_WIDTH + LFT_EDGE, TOP_EDGE, thick, height) ;
 		}
 	}
 
 // Checks to see if a particular digit is valid in a given position.
 static BOOL Conflict(int row, int col, int digit)
 	{
-	uint32_t all_flags ;
-	int blk ;
-
 	if (digit == EMPTY) return FALSE ;
+	return (CellFlags(row, col) & (1 << digit)) != 0 ;
+	}
 
-	blk = 3*(row/3) + col/3 ;
-
-	all_flags = flags[FLAGS_ROWS][row] | flags[FLAGS_COLS][col] | flags[FLAGS_BLKS][blk] ;
-	return (all_flags & (1 << digit)) != 0 ;
+static uint32_t CellFlags(int row, int col)
+	{
+	int blk = BLOCK(row, col) ;
+	return flags[FLAGS_ROWS][row] | flags[FLAGS_COLS][col] | flags[FLAGS_BLKS][blk] ;
 	}
 
 static int SanityChecksOK(void)
@@ -498,20 +1994,7 @@ static void TS_Delay(unsigned clocks)
 static void EditConfiguration(void)
 	{
 #	define MARGIN	2
-	static int ymins[] =
-		{
-		 2 + 0*CELL_HEIGHT,	 3 + 1*CELL_HEIGHT,	 4 + 2*CELL_HEIGHT,
-		 6 + 3*CELL_HEIGHT,	 7 + 4*CELL_HEIGHT,	 8 + 5*CELL_HEIGHT,
-		10 + 6*CELL_HEIGHT,	12 + 7*CELL_HEIGHT,	13 + 8*CELL_HEIGHT
-		} ;
-	static int xmins[] =
-		{
-		 2 + 0*CELL_WIDTH,	 3 + 1*CELL_WIDTH,	 4 + 2*CELL_WIDTH,
-		 6 + 3*CELL_WIDTH,	 7 + 4*CELL_WIDTH,	 8 + 5*CELL_WIDTH,
-		10 + 6*CELL_WIDTH,	11 + 7*CELL_WIDTH,	12 + 8*CELL_WIDTH
-		} ;
-
-	SetFontSize(&Font24) ;
+	SetFontSize(&CELL_FONT) ;
 	digit_foreground = COLOR_WHITE ;
 	digit_background = COLOR_LIGHTGRAY ;
 	while (!PushButtonPressed())
@@ -529,7 +2012,7 @@ static void EditConfiguration(void)
 		// Find row
 		for (row = 0; row < ROWS; row++)
 			{
-			int ymin = ymins[row] + TOP_EDGE + MARGIN ;
+			int ymin = CELL_PXL(row) + row*CELL_HEIGHT + TOP_EDGE + MARGIN ;
 			int ymax = ymin + CELL_HEIGHT - 1 - 2*MARGIN ;
 			if (ymin <= y && y <= ymax) break ;
 			}
@@ -537,26 +2020,146 @@ static void EditConfiguration(void)
 
 		for (col = 0; col < COLS; col++)
 			{
-			int xmin = xmins[col] + LFT_EDGE + MARGIN ;
+			int xmin = CELL_PXL(col) + col*CELL_WIDTH + LFT_EDGE + MARGIN ;
 			int xmax = xmin + CELL_WIDTH - 1 - 2*MARGIN ;
 			if (xmin <= x && x <= xmax)  break ;
 			}
 		if (col == COLS) continue ;
 
-		digit = GetNibble(storage, INDEX(row, col)) ;
+		digit = GetCell(storage, INDEX(row, col)) ;
 		if (digit != EMPTY) report.initial-- ;
 		ClearFlags(row, col, digit) ;
 
-		do digit = (digit + 1) % 10 ;
+		do digit = (digit + 1) % (SIZE + 1) ;
 		while (Conflict(row, col, digit)) ;
 
 		if (digit != EMPTY) report.initial++ ;
 		SetFlags(row, col, digit) ;
-		PutNibble(storage, INDEX(row, col), digit) ;
+		PutCell(storage, INDEX(row, col), digit) ;
 		DisplayCell(row, col, digit) ;
 		}
 	}
 
+static void GeneratePuzzle(void)
+	{
+	// A random solved grid, then cells cleared in random order for as
+	// long as the puzzle keeps exactly one solution.
+	static BOARD board ;
+	uint8_t cells[CELL_BYTES] ;
+	CELL_INDEX order[CELLS] ;
+	uint8_t digits[SIZE] ;
+	int k ;
+
+	// The diagonal blocks share no row, col or blk, so any three
+	// permutations there can be completed; keep the first completion.
+	memset(cells, EMPTY, sizeof(cells)) ;
+	for (int blk = 0; blk < BOX; blk++)
+		{
+		for (k = 0; k < SIZE; k++) digits[k] = k + 1 ;
+		Shuffle(digits, SIZE) ;
+		for (k = 0; k < SIZE; k++) cells[INDEX(BOX*blk + k/BOX, BOX*blk + k%BOX)] = digits[k] ;
+		}
+	count_limit = 0 ;
+	BitboardLoad(&board, cells) ;
+	CountSolutions(&board, 1, initial) ;
+	UnpackCells(initial, cells) ;
+
+	for (k = 0; k < CELLS; k++) order[k] = k ;
+	for (k = CELLS - 1; k > 0; k--)
+		{
+		int j = GetRandomNumber() % (k + 1) ;
+		CELL_INDEX cell = order[k] ;
+		order[k] = order[j] ;
+		order[j] = cell ;
+		}
+	for (k = 0; k < CELLS; k++)
+		{
+		int digit = cells[order[k]] ;
+
+		// On the larger boards a few checks would search for minutes;
+		// a hole that can't be proven safe within DIG_NODES stays filled.
+		cells[order[k]] = EMPTY ;
+		count_limit = report.nodes + DIG_NODES ;
+		BitboardLoad(&board, cells) ;
+		if (CountSolutions(&board, 2, NULL) != 1) cells[order[k]] = digit ;
+		}
+	count_limit = 0 ;
+	PackCells(cells, initial) ;
+	}
+
+static char *GradePuzzle(void)
+	{
+	// Grade the board about to be solved, edits included, by how much
+	// searching the bitboard engine needs: singles alone, a little
+	// branching, or a lot.
+	static BOARD board ;
+	uint8_t cells[CELL_BYTES] ;
+	REPORT saved = report ;
+	unsigned nodes ;
+	int solutions ;
+
+	UnpackCells(storage, cells) ;
+	if (!BitboardLoad(&board, cells)) return "Invalid" ;
+
+	report.nodes = 0 ;
+	solutions = CountSolutions(&board, 2, NULL) ;
+	nodes = report.nodes ;
+	report = saved ;	// grading is not part of the solve
+
+	if (solutions == 0) return "No solution" ;
+	if (solutions > 1) return "Not unique" ;
+	if (nodes == 1) return "Easy" ;
+	return (nodes <= GRADE_MEDIUM) ? "Medium" : "Hard" ;
+	}
+
+static int CountSolutions(BOARD *board, int limit, uint32_t *first)
+	{
+	// Counts solutions up to limit; the first one found is copied to
+	// first (packed like storage) if that isn't NULL.
+	CANDIDATES candidates ;
+	unsigned mark ;
+	int index, count ;
+
+	if (count_limit != 0 && report.nodes >= count_limit) return limit ;
+	report.nodes++ ;
+	if (!BitboardPropagate(board)) return 0 ;
+
+	if (board->filled == CELLS)
+		{
+		if (first != NULL) memcpy(first, board->packed, sizeof(board->packed)) ;
+		return 1 ;
+		}
+
+	index = BitboardFewest(board) ;
+	candidates = board->candidates[index] ;
+	count = 0 ;
+	mark = trail_top ;
+	while (candidates != 0 && count < limit)
+		{
+		int digit = __builtin_ctz(candidates) ;
+
+		candidates &= candidates - 1 ;
+		if (BitboardPlace(board, index, digit))
+			{
+			count += CountSolutions(board, limit - count, (count == 0) ? first : NULL) ;
+			}
+		BitboardUndo(board, mark) ;
+		}
+	return count ;
+	}
+
+static void Shuffle(uint8_t *items, int count)
+	{
+	// Fisher-Yates
+	for (int k = count - 1; k > 0; k--)
+		{
+		int j = GetRandomNumber() % (k + 1) ;
+		uint8_t item = items[k] ;
+		items[k] = items[j] ;
+		items[j] = item ;
+		}
+	}
+
 static void RandomizeGame(void)
 	{
 	RandomizeMajor(SwapRows) ;
@@ -567,12 +2170,12 @@ static void RandomizeGame(void)
 
 static void RandomizeMajor(void (*Swap)(int, int))
 	{
-	int major1 = 3 * (GetRandomNumber() % 3) ;
-	int major2 = 3 * (GetRandomNumber() % 3) ;
+	int major1 = BOX * (GetRandomNumber() % BOX) ;
+	int major2 = BOX * (GetRandomNumber() % BOX) ;
 
 	if (major1 == major2) return ;
 
-	for (int minor = 0; minor < 3; minor++)
+	for (int minor = 0; minor < BOX; minor++)
 		{
 		(*Swap)(major1++, major2++) ;
 		}
@@ -582,8 +2185,8 @@ static void RandomizeMinor(void (*Swap)(int, int))
 	{
 	for (int block = 0; block < BLKS; block++)
 		{
-		int minor1 = 3*(block / 3) + (GetRandomNumber() % 3) ;
-		int minor2 = 3*(block / 3) + (GetRandomNumber() % 3) ;
+		int minor1 = BOX*(block / BOX) + (GetRandomNumber() % BOX) ;
+		int minor2 = BOX*(block / BOX) + (GetRandomNumber() % BOX) ;
 		if (minor1 != minor2) (*Swap)(minor1, minor2) ;
 		}
 	}
@@ -594,10 +2197,10 @@ static void SwapRows(int row1, int row2)
 	int idx2 = COLS*row2 ;
 	for (int col = 0; col < COLS; col++)
 		{
-		uint32_t cell1 = GetNibble(initial, idx1) ;
-		uint32_t cell2 = GetNibble(initial, idx2) ;
-		PutNibble(initial, idx1, cell2) ;
-		PutNibble(initial, idx2, cell1) ;
+		uint32_t cell1 = GetCell(initial, idx1) ;
+		uint32_t cell2 = GetCell(initial, idx2) ;
+		PutCell(initial, idx1, cell2) ;
+		PutCell(initial, idx2, cell1) ;
 		idx1 += 1 ;
 		idx2 += 1 ;
 		}
@@ -609,29 +2212,70 @@ static void SwapCols(int col1, int col2)
 	int idx2 = 1*col2 ;
 	for (int row = 0; row < ROWS; row++)
 		{
-		uint32_t cell1 = GetNibble(initial, idx1) ;
-		uint32_t cell2 = GetNibble(initial, idx2) ;
-		PutNibble(initial, idx1, cell2) ;
-		PutNibble(initial, idx2, cell1) ;
+		uint32_t cell1 = GetCell(initial, idx1) ;
+		uint32_t cell2 = GetCell(initial, idx2) ;
+		PutCell(initial, idx1, cell2) ;
+		PutCell(initial, idx2, cell1) ;
 		idx1 += COLS ;
 		idx2 += COLS ;
 		}
 	}
 
+#if CELL_BITS == 5
+static uint32_t GetFiveBits(const void *cells, uint32_t which)
+	{
+	const uint32_t *word = (const uint32_t *) cells + which / CELLS_PER_WORD ;
+	return (*word >> 5*(which % CELLS_PER_WORD)) & 0x1F ;
+	}
+
+static void PutFiveBits(void *cells, uint32_t which, uint32_t value)
+	{
+	uint32_t *word = (uint32_t *) cells + which / CELLS_PER_WORD ;
+	int shift = 5*(which % CELLS_PER_WORD) ;
+	*word = (*word & ~(0x1F << shift)) | (value << shift) ;
+	}
+
+static void UnpackFiveBits(const void *cells, uint8_t *bytes)
+	{
+	const uint32_t *word = (const uint32_t *) cells ;
+
+	for (int k = 0; k < WORDS; k++, word++)
+		{
+		uint32_t fields = *word ;
+		for (int j = 0; j < CELLS_PER_WORD; j++, fields >>= 5) *bytes++ = fields & 0x1F ;
+		}
+	}
+
+static void PackFiveBits(const uint8_t *bytes, void *cells)
+	{
+	uint32_t *word = (uint32_t *) cells ;
+
+	for (int k = 0; k < WORDS; k++, word++)
+		{
+		uint32_t fields = 0 ;
+		for (int j = 0; j < CELLS_PER_WORD; j++) fields |= (uint32_t) *bytes++ << 5*j ;
+		*word = fields ;
+		}
+	}
+#endif
+
 static void InitializeFlags(void)
 	{
+	uint8_t cells[CELL_BYTES] ;
+
+	UnpackCells(initial, cells) ;
+	report.getCalls += CELLS ;
 	memset(flags, 0, sizeof(flags)) ;
 	for (int index = 0; index < CELLS; index++)
 		{
-		int digit = GetNibble(initial, index) ;
+		int digit = cells[index] ;
 
-		report.getCalls++ ;
 		if (digit != EMPTY)
 			{
 			int bit = 1 << digit ;
 			int row = index / COLS ;
 			int col = index % COLS ;
-			int blk = 3*(row/3) + col/3 ;
+			int blk = BLOCK(row, col) ;
 
 			flags[FLAGS_ROWS][row] |= bit ;
 			flags[FLAGS_COLS][col] |= bit ;
@@ -640,27 +2284,63 @@ static void InitializeFlags(void)
 			report.initial++ ;
 			}
 		}
+
+	for (int index = 0; index < CELLS; index++)
+		{
+		int row = index / COLS ;
+		int col = index % COLS ;
+
+		counts[index] = SIZE - __builtin_popcount(CellFlags(row, col)) ;
+		if (cells[index] != EMPTY) counts[index] += FILLED ;
+		}
 	}
 
 static void ClearFlags(int row, int col, int digit)
 	{
 	uint32_t bit = 1 << digit ;
-	int blk = 3*(row/3) + col/3 ;
+	int blk = BLOCK(row, col) ;
+
+	if (digit == EMPTY) return ;
 	flags[FLAGS_ROWS][row] &= ~bit ;
 	flags[FLAGS_COLS][col] &= ~bit ;
 	flags[FLAGS_BLKS][blk] &= ~bit ;
+	UpdateCounts(INDEX(row, col), bit, +1) ;
+	counts[INDEX(row, col)] -= FILLED ;
 	}
 
 static void SetFlags(int row, int col, int digit)
 	{
 	uint32_t bit = 1 << digit ;
-	int blk = 3*(row/3) + col/3 ;
+	int blk = BLOCK(row, col) ;
+
+	if (digit == EMPTY) return ;
+	UpdateCounts(INDEX(row, col), bit, -1) ;
+	counts[INDEX(row, col)] += FILLED ;
 	flags[FLAGS_ROWS][row] |= bit ;
 	flags[FLAGS_COLS][col] |= bit ;
 	flags[FLAGS_BLKS][blk] |= bit ;
 	}
 
-static int Cell2Fill(int index)
+static void UpdateCounts(int index, uint32_t bit, int delta)
 	{
-	return (index + 1) % CELLS ;
+	// Only peers not already excluded from the digit by another
+	// row, col or blk gain or lose it as a legal choice.
+	for (int k = 0; k < PEERS; k++)
+		{
+		int peer = peers[index][k] ;
+		if ((CellFlags(peer / COLS, peer % COLS) & bit) == 0) counts[peer] += delta ;
+		}
+	}
+
+static int Cell2Fill(void)
+	{
+	// Minimum remaining values: the empty cell with the fewest legal
+	// digits, so dead ends are found with as few placements as possible.
+	int fewest = 0 ;
+
+	for (int index = 1; index < CELLS && counts[fewest] > 1; index++)
+		{
+		if (counts[index] < counts[fewest]) fewest = index ;
+		}
+	return fewest ;
 	}
@@ -0,0 +1,84 @@
+/*
+*   File Name: lab_sudoku_bulk_src.s
+*
+*   Description: Whole-board versions of GetNibble and PutNibble. Each
+*   word of a nibble array holds 8 cells; these move all 8 at once with
+*   the Cortex-M4 byte-lane (UXTB16) and halfword-pack (PKHBT/PKHTB)
+*   instructions instead of one call per cell.
+*
+*/
+
+    .syntax     unified
+    .cpu        cortex-m4
+    .text
+
+// ----------------------------------------------------------
+// void UnpackNibbles(const void *nibbles, uint8_t *bytes, uint32_t words);
+//
+//  Description:
+//  Copies 8*words cells from a nibble array into an array of bytes,
+//  one cell per byte, in the same order GetNibble numbers them.
+// ----------------------------------------------------------
+
+    .global     UnpackNibbles
+    .thumb_func
+    .align
+
+UnpackNibbles:      //R0 = nibbles, R1 = bytes, R2 = words
+        PUSH {R4-R7}
+        LDR R3,=0x0F0F0F0F  //R3 <-- low nibble of every byte
+        CMP R2,0
+        BEQ UnpackDone
+UnpackLoop:
+        LDR R4,[R0],4       //R4 <-- cells 7..0, cell 0 in bits 3..0
+        AND R5,R4,R3        //R5 <-- bytes: c0 c2 c4 c6
+        AND R6,R3,R4,LSR 4  //R6 <-- bytes: c1 c3 c5 c7
+        UXTB16 R4,R5        //R4 <-- c0 | c4 << 16
+        UXTB16 R5,R5,ROR 8  //R5 <-- c2 | c6 << 16
+        UXTB16 R7,R6        //R7 <-- c1 | c5 << 16
+        UXTB16 R6,R6,ROR 8  //R6 <-- c3 | c7 << 16
+        ORR R4,R4,R7,LSL 8  //R4 <-- bytes: c0 c1 c4 c5
+        ORR R5,R5,R6,LSL 8  //R5 <-- bytes: c2 c3 c6 c7
+        PKHBT R6,R4,R5,LSL 16   //R6 <-- bytes: c0 c1 c2 c3
+        PKHTB R7,R5,R4,ASR 16   //R7 <-- bytes: c4 c5 c6 c7
+        STR R6,[R1],4
+        STR R7,[R1],4
+        SUBS R2,R2,1
+        BNE UnpackLoop
+UnpackDone:
+        POP {R4-R7}
+        BX LR
+
+// ----------------------------------------------------------
+// void PackNibbles(const uint8_t *bytes, void *nibbles, uint32_t words);
+//
+//  Description:
+//  The reverse of UnpackNibbles: packs 8*words bytes (each 0..15)
+//  into a nibble array, 8 cells per word.
+// ----------------------------------------------------------
+
+    .global     PackNibbles
+    .thumb_func
+    .align
+
+PackNibbles:        //R0 = bytes, R1 = nibbles, R2 = words
+        PUSH {R4}
+        CMP R2,0
+        BEQ PackDone
+PackLoop:
+        LDR R3,[R0],4       //R3 <-- bytes: c0 c1 c2 c3
+        LDR R4,[R0],4       //R4 <-- bytes: c4 c5 c6 c7
+        ORR R3,R3,R3,LSR 4  //R3 <-- byte 0 = c1:c0, byte 2 = c3:c2
+        ORR R4,R4,R4,LSR 4  //R4 <-- byte 0 = c5:c4, byte 2 = c7:c6
+        UXTB16 R3,R3        //R3 <-- c1:c0 | c3:c2 << 16
+        UXTB16 R4,R4        //R4 <-- c5:c4 | c7:c6 << 16
+        ORR R3,R3,R3,LSR 8  //R3 <-- low half = c3:c2:c1:c0
+        ORR R4,R4,R4,LSR 8  //R4 <-- low half = c7:c6:c5:c4
+        PKHBT R3,R3,R4,LSL 16   //R3 <-- c7 .. c0
+        STR R3,[R1],4
+        SUBS R2,R2,1
+        BNE PackLoop
+PackDone:
+        POP {R4}
+        BX LR
+        .end
@@ -0,0 +1,327 @@
+/*
+*   File Name: lab_civil_dates_src.s
+*
+*   Description: Gregorian calendar conversions done the way Zeller2
+*   does its arithmetic: every division is by a constant, so each one is
+*   a multiply by a scaled reciprocal and a shift, with no UDIV or SDIV.
+*   Each reciprocal is exact over the range it is used in, for years
+*   1 through 9999. Days count from 1970-01-01; a date is packed as
+*   year << 16 | month << 8 | day.
+*
+*   Conversions follow H. Hinnant's days_from_civil and civil_from_days,
+*   which start the year on March 1 so the leap day comes last.
+*
+*/
+
+    .syntax     unified
+    .cpu        cortex-m4
+    .text
+
+// The conversions are macros so the batch loops run them inline; each
+// uses only R0-R3 and R12.
+
+// R0 = year, R1 = month, R2 = day --> R0 = days since 1970-01-01
+    .macro      DAYS_FROM_CIVIL
+        CMP R1,2
+        ITTE LS
+        ADDLS R1,R1,9           //Jan, Feb: mp = m + 9,
+        SUBLS R0,R0,1           //  counted as the end of the year before
+        SUBHI R1,R1,3           //Otherwise mp = m - 3
+        LDR R3,=153
+        MUL R1,R1,R3
+        ADD R1,R1,2             //R1 <-- 153mp + 2
+        LDR R3,=52429
+        MUL R1,R1,R3
+        ADD R2,R2,R1,LSR 18     //R2 <-- d + (153mp + 2)/5
+        LDR R3,=5243
+        MUL R12,R0,R3
+        LSR R12,R12,19          //R12 <-- y/100
+        LDR R3,=365
+        MUL R1,R0,R3            //R1 <-- 365y
+        ADD R1,R1,R0,LSR 2      //R1 <-- 365y + y/4
+        SUB R1,R1,R12           //R1 <-- 365y + y/4 - y/100
+        ADD R1,R1,R12,LSR 2     //R1 <-- 365y + y/4 - y/100 + y/400
+        ADD R0,R1,R2
+        LDR R3,=719469          //0000-03-01 to 1970-01-01, plus 1 as d starts at 1
+        SUB R0,R0,R3
+    .endm
+
+// R0 = days since 1970-01-01 --> R0 = year << 16 | month << 8 | day
+    .macro      CIVIL_FROM_DAYS
+        LDR R3,=719468
+        ADD R0,R0,R3            //R0 <-- z, days since 0000-03-01
+        LDR R3,=3762951
+        UMULL R12,R1,R0,R3
+        LSR R1,R1,7             //R1 <-- era = z/146097, 400 years each
+        LDR R3,=146097
+        MLS R0,R1,R3,R0         //R0 <-- doe, day of the era
+        LDR R3,=2941759
+        UMULL R12,R2,R0,R3      //R2 <-- doe/1460
+        SUB R2,R0,R2            //R2 <-- doe - doe/1460
+        LDR R3,=235187
+        UMULL R3,R12,R0,R3
+        ADD R2,R2,R12,LSR 1     //R2 <-- + doe/36524
+        LDR R3,=146096
+        CMP R0,R3
+        IT EQ
+        SUBEQ R2,R2,1           //R2 <-- - doe/146096
+        LDR R3,=11767034
+        UMULL R12,R2,R2,R3      //R2 <-- yoe = R2/365, year of the era
+        LDR R3,=365
+        MLS R0,R2,R3,R0         //R0 <-- doe - 365yoe
+        SUB R0,R0,R2,LSR 2      //R0 <-- - yoe/4
+        LDR R3,=41
+        MUL R12,R2,R3
+        ADD R0,R0,R12,LSR 12    //R0 <-- doy = + yoe/100, day from March 1
+        LDR R3,=400
+        MLA R1,R1,R3,R2         //R1 <-- y = 400era + yoe
+        ADD R2,R0,R0,LSL 2
+        ADD R2,R2,2             //R2 <-- 5doy + 2
+        LDR R3,=857
+        MUL R2,R2,R3
+        LSR R2,R2,17            //R2 <-- mp = (5doy + 2)/153
+        LDR R3,=153
+        MUL R12,R2,R3
+        ADD R12,R12,2           //R12 <-- 153mp + 2
+        LDR R3,=52429
+        MUL R12,R12,R3
+        SUB R0,R0,R12,LSR 18
+        ADD R0,R0,1             //R0 <-- d = doy - (153mp + 2)/5 + 1
+        CMP R2,10
+        ITTE HS
+        SUBHS R2,R2,9           //Jan, Feb: m = mp - 9,
+        ADDHS R1,R1,1           //  in the year after
+        ADDLO R2,R2,3           //Otherwise m = mp + 3
+        ORR R0,R0,R2,LSL 8
+        ORR R0,R0,R1,LSL 16
+    .endm
+
+// R0 = year --> R0 = 1 if a leap year, else 0 (uses R1-R3)
+    .macro      LEAP_YEAR
+        LDR R3,=5243
+        MUL R1,R0,R3
+        LSR R1,R1,19            //R1 <-- y/100
+        LDR R3,=100
+        MLS R2,R1,R3,R0         //R2 <-- y%100
+        CMP R2,0
+        IT EQ
+        MOVEQ R0,R1             //Centuries: y/100 must be a multiple of 4 instead
+        TST R0,3
+        ITE EQ
+        MOVEQ R0,1
+        MOVNE R0,0
+    .endm
+
+// ----------------------------------------------------------
+// int32_t DaysFromCivil(uint32_t year, uint32_t month, uint32_t day);
+// ----------------------------------------------------------
+
+    .global     DaysFromCivil
+    .thumb_func
+    .align
+
+DaysFromCivil:      //R0 = year, R1 = month, R2 = day
+        DAYS_FROM_CIVIL
+        BX LR
+
+// ----------------------------------------------------------
+// uint32_t CivilFromDays(int32_t days);
+// ----------------------------------------------------------
+
+    .global     CivilFromDays
+    .thumb_func
+    .align
+
+CivilFromDays:      //R0 = days since 1970-01-01
+        CIVIL_FROM_DAYS
+        BX LR
+
+// ----------------------------------------------------------
+// uint32_t IsLeapYear(uint32_t year);
+// ----------------------------------------------------------
+
+    .global     IsLeapYear
+    .thumb_func
+    .align
+
+IsLeapYear:         //R0 = year
+        LEAP_YEAR
+        BX LR
+
+// ----------------------------------------------------------
+// uint32_t DayOfYear(uint32_t year, uint32_t month, uint32_t day);
+//
+//  Description:
+//  Returns 1 for January 1 through 365 or 366 for December 31.
+// ----------------------------------------------------------
+
+    .global     DayOfYear
+    .thumb_func
+    .align
+
+DayOfYear:          //R0 = year, R1 = month, R2 = day
+        CMP R1,2
+        ITE LS
+        ADDLS R1,R1,9           //mp as in DAYS_FROM_CIVIL
+        SUBHI R1,R1,3
+        LDR R3,=153
+        MUL R1,R1,R3
+        ADD R1,R1,2
+        LDR R3,=52429
+        MUL R1,R1,R3
+        ADD R12,R2,R1,LSR 18    //R12 <-- days from March 1, counting from 1
+        BHI DoyMarch            //Flags are still from CMP R1,2
+        SUB R0,R12,306          //Jan, Feb: March 1 is 306 days after January 1
+        BX LR
+DoyMarch:
+        LEAP_YEAR
+        ADD R0,R0,R12
+        ADD R0,R0,59            //R0 <-- + Jan, Feb and leap day
+        BX LR
+
+// ----------------------------------------------------------
+// uint32_t IsoWeek(uint32_t year, uint32_t month, uint32_t day);
+//
+//  Description:
+//  Returns the ISO 8601 week-numbering year << 16 | week (1-53).
+//  Weeks start on Monday, and week 1 holds the year's first Thursday,
+//  so days near January 1 can belong to the year before or after.
+//  Valid for years 2 through 9999.
+// ----------------------------------------------------------
+
+    .global     IsoWeek
+    .thumb_func
+    .align
+
+IsoWeek:            //R0 = year, R1 = month, R2 = day
+        PUSH {R4-R7,LR}
+        MOV R4,R0
+        MOV R5,R1
+        MOV R6,R2
+        BL DayOfYear
+        MOV R7,R0               //R7 <-- day of year
+        MOV R0,R4
+        MOV R1,R5
+        MOV R2,R6
+        DAYS_FROM_CIVIL
+        LDR R3,=719468 + 2
+        ADD R0,R0,R3            //0000-03-01 was a Wednesday
+        LDR R3,=613566757
+        UMULL R12,R1,R0,R3      //R1 <-- R0/7
+        LSL R2,R1,3
+        SUB R2,R2,R1
+        SUB R0,R0,R2            //R0 <-- weekday, 0 = Monday
+        SUB R7,R7,R0
+        ADD R7,R7,9             //R7 <-- doy - weekday + 9
+        LDR R3,=9363
+        MUL R7,R7,R3
+        LSR R7,R7,16            //R7 <-- week = R7/7
+        CMP R7,0
+        BEQ IsoYearBefore
+        CMP R7,53
+        BNE IsoDone
+        MOV R0,R4
+        BL WeeksInYear
+        CMP R0,53
+        BEQ IsoDone
+        ADD R4,R4,1             //A 52 week year: week 1 of the next
+        MOV R7,1
+        B IsoDone
+IsoYearBefore:
+        SUB R4,R4,1             //Last week of the year before
+        MOV R0,R4
+        BL WeeksInYear
+        MOV R7,R0
+IsoDone:
+        ORR R0,R7,R4,LSL 16
+        POP {R4-R7,PC}
+
+// R0 = year --> R0 = 52 or 53 weeks (uses R1-R4)
+    .thumb_func
+
+WeeksInYear:
+        PUSH {R4,LR}
+        MOV R4,R0
+        BL YearEndDay
+        CMP R0,4                //Year ends on a Thursday
+        BEQ Weeks53
+        SUB R0,R4,1
+        BL YearEndDay
+        CMP R0,3                //Year before ends on a Wednesday,
+                                //  so this one starts on a Thursday
+        BEQ Weeks53
+        MOV R0,52
+        POP {R4,PC}
+Weeks53:
+        MOV R0,53
+        POP {R4,PC}
+
+// R0 = year --> R0 = weekday of its December 31, 0 = Sunday (uses R1-R3)
+    .thumb_func
+
+YearEndDay:
+        LDR R3,=5243
+        MUL R1,R0,R3
+        LSR R1,R1,19            //R1 <-- y/100
+        ADD R2,R0,R0,LSR 2
+        SUB R2,R2,R1
+        ADD R2,R2,R1,LSR 2      //R2 <-- y + y/4 - y/100 + y/400
+        LDR R3,=613566757
+        UMULL R3,R1,R2,R3       //R1 <-- R2/7
+        LSL R3,R1,3
+        SUB R3,R3,R1
+        SUB R0,R2,R3            //R0 <-- R2 - 7(R2/7)
+        BX LR
+
+// ----------------------------------------------------------
+// void DaysFromCivilBatch(const uint32_t *dates, int32_t *days, uint32_t count);
+// ----------------------------------------------------------
+
+    .global     DaysFromCivilBatch
+    .thumb_func
+    .align
+
+DaysFromCivilBatch: //R0 = dates, R1 = days, R2 = count
+        PUSH {R4-R6}
+        MOV R4,R0
+        MOV R5,R1
+        MOVS R6,R2
+        BEQ DfcBatchDone
+DfcBatchLoop:
+        LDR R3,[R4],4
+        LSR R0,R3,16            //R0 <-- year
+        UBFX R1,R3,8,8          //R1 <-- month
+        UXTB R2,R3              //R2 <-- day
+        DAYS_FROM_CIVIL
+        STR R0,[R5],4
+        SUBS R6,R6,1
+        BNE DfcBatchLoop
+DfcBatchDone:
+        POP {R4-R6}
+        BX LR
+
+// ----------------------------------------------------------
+// void CivilFromDaysBatch(const int32_t *days, uint32_t *dates, uint32_t count);
+// ----------------------------------------------------------
+
+    .global     CivilFromDaysBatch
+    .thumb_func
+    .align
+
+CivilFromDaysBatch: //R0 = days, R1 = dates, R2 = count
+        PUSH {R4-R6}
+        MOV R4,R0
+        MOV R5,R1
+        MOVS R6,R2
+        BEQ CfdBatchDone
+CfdBatchLoop:
+        LDR R0,[R4],4
+        CIVIL_FROM_DAYS
+        STR R0,[R5],4
+        SUBS R6,R6,1
+        BNE CfdBatchLoop
+CfdBatchDone:
+        POP {R4-R6}
+        BX LR
+
+        .end
@@ -0,0 +1,65 @@
+/*
+*   File Name: lab_zellers_batch_src.s
+*
+*   Description: Zeller's rule over a whole array of dates. Same sum as
+*   Zeller2, but the divisions are done as multiplies by constants small
+*   enough for a plain MUL over the range of packed dates, and the loop
+*   loads the next date while the current one is being worked on.
+*
+*/
+
+    .syntax     unified
+    .cpu        cortex-m4
+    .text
+
+// ----------------------------------------------------------
+// void ZellerBatch(const uint32_t *dates, uint8_t *weekdays, uint32_t count);
+//
+//  Description:
+//  Writes the weekday (0 = Sunday) of each of count dates. A date is
+//  packed as k | m << 8 | D << 16 | C << 24, with the same k, m, D and C
+//  that Zeller1-3 take; C must be 99 or less.
+//
+//  f is biased by 7*30 so it is never negative, which makes the mod 7
+//  an unsigned (f * 9363) >> 16 quotient with no fixup afterwards:
+//      (13m - 1)/5 + 210   = (2665m + 210*1024 - 205) >> 10
+//      f/7 for 0 <= f < 420 = (9363f) >> 16
+// ----------------------------------------------------------
+
+    .global     ZellerBatch
+    .thumb_func
+    .align
+
+ZellerBatch:        //R0 = dates, R1 = weekdays, R2 = count
+        PUSH {R4-R11}
+        CMP R2,0
+        BEQ BatchDone
+        LDR R12,=2665           //R12 <-- 13*1024/5, rounded up
+        LDR R11,=(210 << 10) - 205
+        LDR R10,=9363           //R10 <-- 65536/7, rounded up
+        LDR R9,=7
+        LDR R3,[R0],4           //R3 <-- first date
+BatchLoop:
+        UBFX R4,R3,0,8          //R4 <-- k
+        UBFX R5,R3,8,8          //R5 <-- m
+        UBFX R6,R3,16,8         //R6 <-- D
+        LSR R7,R3,24            //R7 <-- C
+        SUBS R2,R2,1            //Flags stay set until BNE below
+        IT NE
+        LDRNE R3,[R0],4         //R3 <-- next date, while this one is computed
+        MLA R8,R5,R12,R11       //R8 <-- ((13m - 1)/5 + 210) << 10, plus fraction
+        ADD R8,R4,R8,LSR 10     //R8 <-- f = k + (13m - 1)/5 + 210
+        ADD R8,R8,R6            //R8 <-- f + D
+        ADD R8,R8,R6,LSR 2      //R8 <-- f + (D>>2)
+        ADD R8,R8,R7,LSR 2      //R8 <-- f + (C>>2)
+        SUB R8,R8,R7,LSL 1      //R8 <-- f - (C<<1)
+        MUL R4,R8,R10           //R4 <-- f * 9363
+        LSR R4,R4,16            //R4 <-- f / 7
+        MLS R8,R4,R9,R8         //R8 <-- f - 7 * (f / 7)
+        STRB R8,[R1],1
+        BNE BatchLoop
+BatchDone:
+        POP {R4-R11}
+        BX LR
+
+        .end
@@ -18,6 +18,19 @@
 extern uint32_t		Zeller1(uint32_t k, uint32_t m, uint32_t D, uint32_t C) ;
 extern uint32_t		Zeller2(uint32_t k, uint32_t m, uint32_t D, uint32_t C) ;
 extern uint32_t		Zeller3(uint32_t k, uint32_t m, uint32_t D, uint32_t C) ;
+extern uint32_t		Zeller4(uint32_t k, uint32_t m, uint32_t D, uint32_t C) ;
+
+// Array version in lab_zellers_batch_src.s; dates packed by Z_PACK
+extern void			ZellerBatch(const uint32_t *dates, uint8_t *weekdays, uint32_t count) ;
+
+// Divide-free calendar library in lab_civil_dates_src.s; dates packed by CIVIL
+extern int32_t		DaysFromCivil(uint32_t year, uint32_t month, uint32_t day) ;
+extern uint32_t		CivilFromDays(int32_t days) ;
+extern uint32_t		DayOfYear(uint32_t year, uint32_t month, uint32_t day) ;
+extern uint32_t		IsLeapYear(uint32_t year) ;
+extern uint32_t		IsoWeek(uint32_t year, uint32_t month, uint32_t day) ;
+extern void			DaysFromCivilBatch(const uint32_t *dates, int32_t *days, uint32_t count) ;
+extern void			CivilFromDaysBatch(const int32_t *days, uint32_t *dates, uint32_t count) ;
 
 typedef int			BOOL ;
 #define	FALSE		0
@@ -51,7 +64,10 @@ static BOOL			Between(uint32_t min, uint32_t val, uint32_t max) ;
 static int			DaysInMonth(int month, int year) ;
 static void			Delay(uint32_t msec) ;
 static void			DisplayAdjusts(void) ;
+static void			DisplayBatch(unsigned dates, unsigned cycles) ;
+static void			DisplayCivil(unsigned cycles[], unsigned dates, unsigned batch[]) ;
 static void			DisplayCycles(unsigned which, unsigned cycles) ;
+static void			DisplaySweep(void) ;
 static void			DisplayWeekday(int day) ;
 static void			Error(char *functname, char *format, ...) ;
 static uint32_t		GetTimeout(uint32_t msec) ;
@@ -59,11 +75,15 @@ static void			InitializeDate(void) ;
 static void			InitializeTouchScreen(void) ;
 static BOOL			LeapYear(int year) ;
 static void			LEDs(int grn_on, int red_on) ;
+static unsigned		LoadYear(uint32_t dates[], int year) ;
 static char *		Month(int val) ;
 static char *		Number(int val) ;
 static void 		SanityCheck(void) ;
 static void			SetFontSize(sFONT *Font) ;
 static void			SetupAdjusts(void) ;
+static void			SweepDates(unsigned ovhd) ;
+static void			TimeBatch(void) ;
+static void			TimeCivil(unsigned ovhd) ;
 
 #define	CPU_CLOCK_SPEED_MHZ			168
 
@@ -97,6 +117,14 @@ static void			SetupAdjusts(void) ;
 
 #define	ERROR_YPOS		CYCLES_YPOS(1)
 
+#define	SWEEP_MODE		0		// 1: check every date from SWEEP_FIRST on, headless, before the lab starts
+#define	SWEEP_FIRST		1583	// first full Gregorian year
+#define	SWEEP_LAST		9999
+#define	SWEEP_WEEKDAY	6		// Jan 1, 1583 was a Saturday
+#define	SWEEP_CYCLES	64		// histogram bins, one per cycle; the last is that many or more
+#define	SWEEP_PER_LINE	3		// histogram bins listed per line
+#define	SWEEP_YPOS		55
+
 #define	TS_XFUDGE		-4
 #define	TS_YFUDGE		-4
 
@@ -107,9 +135,21 @@ static ADJUST adjusts[] =
 	{" Date:", ADJUST_XDATE, ADJUST_YDATE, &adjust.date, Number, 1, 31, TRUE},
 	{" Year:", ADJUST_XYEAR, ADJUST_YYEAR, &adjust.year, Number, 1752, 3000, FALSE}
 	} ;
-static uint32_t (*functions[])() = {Zeller1, Zeller2, Zeller3} ;
-static char *functname[] = {"Zeller1", "Zeller2", "Zeller3"} ;
-static char *label[] = {"Uses Div & Mul", "No Divide", "No Multiply"} ;
+static uint32_t (*functions[])() = {Zeller1, Zeller2, Zeller3, Zeller4} ;
+static char *functname[] = {"Zeller1", "Zeller2", "Zeller3", "Zeller4"} ;
+static char *label[] = {"Uses Div & Mul", "No Divide", "No Multiply", "Lookup Tables"} ;
+
+// SWEEP_MODE results, one per entry of functions[]
+static struct
+	{
+	unsigned	histogram[SWEEP_CYCLES] ;	// calls that took k cycles
+	unsigned	calls ;
+	unsigned	total ;			// cycles for all calls
+	unsigned	worst ;			// cycles for the slowest call,
+	unsigned	worst_date ;	//   on this date, packed by CIVIL
+	unsigned	wrong ;			// calls that disagreed with the reference,
+	unsigned	first_wrong ;	//   the first on this date
+	} sweep[ENTRIES(functions)] ;
 static char *weekday[] =
 	{
 	"Sunday", "Monday", "Tuesday", "Wednesday", "Thursday", "Friday", "Saturday"
@@ -124,6 +164,11 @@ static char *months[] =
 #define	Z_D(mnth, year)	((year - (mnth < 3)) % 100)
 #define	Z_C(mnth, year)	((year - (mnth < 3)) / 100) 
 
+#define	Z_PACK(k, m, D, C)	((k) | (m) << 8 | (D) << 16 | (C) << 24)
+
+#define	CIVIL(year, mnth, date)	((year) << 16 | (mnth) << 8 | (date))
+#define	ISO(year, week)			((year) << 16 | (week))
+
 int main()
 	{
 	uint32_t params[4], results[2], delay1, delay2 ;
@@ -136,6 +181,15 @@ int main()
 	SetupAdjusts() ;
 	ovhd = CountCycles(CallReturnOverhead, params, params, results) ;
 
+	if (SWEEP_MODE)
+		{
+		SweepDates(ovhd) ;
+		DisplaySweep() ;
+		WaitForPushButton() ;
+		ClearDisplay() ;
+		SetupAdjusts() ;
+		}
+
 	delay1 = delay2 = 0 ;
 	while (1)
 		{
@@ -157,6 +211,8 @@ int main()
 			DisplayCycles(which, cycles) ;
 			prev = day ;
 			}
+		TimeBatch() ;
+		TimeCivil(ovhd) ;
 
 		Delay(delay1) ;
 		delay1 = delay2 ;
@@ -179,7 +235,8 @@ int main()
 
 static void SanityCheck(void)
 	{
-	unsigned day ;
+	unsigned day, date ;
+	int days ;
 
 	LEDs(1, 0) ;
 
@@ -191,6 +248,172 @@ static void SanityCheck(void)
 
 	day = Zeller3(Z_K(1), Z_M(4), Z_D(4, 2001), Z_C(4, 2001)) ;
 	if (day != 0) Error("Zeller3", "4/1/01 != %u", day) ;
+
+	day = Zeller4(Z_K(29), Z_M(2), Z_D(2, 2000), Z_C(2, 2000)) ;
+	if (day != 2) Error("Zeller4", "2/29/00 != %u", day) ;
+
+	days = DaysFromCivil(1970, 1, 1) ;
+	if (days != 0) Error("DaysFromCivil", "1/1/1970 != %d", days) ;
+
+	days = DaysFromCivil(2000, 3, 1) ;
+	if (days != 11017) Error("DaysFromCivil", "3/1/2000 != %d", days) ;
+
+	date = CivilFromDays(-1) ;
+	if (date != CIVIL(1969, 12, 31)) Error("CivilFromDays", "-1 != %08X", date) ;
+
+	date = DayOfYear(2000, 12, 31) ;
+	if (date != 366) Error("DayOfYear", "12/31/2000 != %u", date) ;
+
+	if (IsLeapYear(1900) || !IsLeapYear(2000)) Error("IsLeapYear", "1900 or 2000 wrong") ;
+
+	date = IsoWeek(2021, 1, 3) ;
+	if (date != ISO(2020, 53)) Error("IsoWeek", "1/3/2021 != %08X", date) ;
+
+	date = IsoWeek(2008, 12, 29) ;
+	if (date != ISO(2009, 1)) Error("IsoWeek", "12/29/2008 != %08X", date) ;
+	}
+
+static void TimeBatch(void)
+	{
+	// Every day of the selected year through ZellerBatch, checked
+	// against Zeller2 one date at a time.
+	static uint32_t dates[366] ;
+	static uint8_t weekdays[366] ;
+	unsigned count, strt, stop, k, day ;
+
+	count = LoadYear(dates, adjust.year) ;
+
+	strt = GetClockCycleCount() ;
+	ZellerBatch(dates, weekdays, count) ;
+	stop = GetClockCycleCount() ;
+
+	for (k = 0; k < count; k++)
+		{
+		day = Zeller2(dates[k] & 0xFF, (dates[k] >> 8) & 0xFF, (dates[k] >> 16) & 0xFF, dates[k] >> 24) ;
+		if (weekdays[k] != day)
+			Error("ZellerBatch", "Day %u: %u != Zeller2", k + 1, weekdays[k]) ;
+		}
+
+	DisplayBatch(count, stop - strt) ;
+	}
+
+static void TimeCivil(unsigned ovhd)
+	{
+	// The selected date through DaysFromCivil and back, then every day
+	// of its year through both batch calls, which must round trip.
+	static uint32_t dates[366], again[366] ;
+	static int32_t days[366] ;
+	uint32_t params[4], results[2] ;
+	unsigned cycles[2], batch[2], count, strt, stop, k ;
+	int mnth, date ;
+
+	params[0] = adjust.year ;
+	params[1] = adjust.mnth ;
+	params[2] = adjust.date ;
+	cycles[0] = CountCycles(DaysFromCivil, params, params, results) - ovhd ;
+	params[0] = results[0] ;
+	cycles[1] = CountCycles(CivilFromDays, params, params, results) - ovhd ;
+	if (results[0] != CIVIL(adjust.year, adjust.mnth, adjust.date))
+		Error("CivilFromDays", "Day %d: %08X", (int) params[0], results[0]) ;
+
+	count = 0 ;
+	for (mnth = 1; mnth <= 12; mnth++)
+		{
+		for (date = 1; date <= DaysInMonth(mnth, adjust.year); date++)
+			{
+			dates[count++] = CIVIL(adjust.year, mnth, date) ;
+			}
+		}
+
+	strt = GetClockCycleCount() ;
+	DaysFromCivilBatch(dates, days, count) ;
+	stop = GetClockCycleCount() ;
+	batch[0] = stop - strt ;
+
+	strt = GetClockCycleCount() ;
+	CivilFromDaysBatch(days, again, count) ;
+	stop = GetClockCycleCount() ;
+	batch[1] = stop - strt ;
+
+	for (k = 0; k < count; k++)
+		{
+		if (days[k] != days[0] + (int) k)
+			Error("DaysFromCivilBatch", "Day %u: %d", k + 1, days[k]) ;
+		if (again[k] != dates[k])
+			Error("CivilFromDaysBatch", "Day %u: %08X", k + 1, again[k]) ;
+		if (DayOfYear(adjust.year, (dates[k] >> 8) & 0xFF, dates[k] & 0xFF) != k + 1)
+			Error("DayOfYear", "Day %u is wrong", k + 1) ;
+		}
+
+	DisplayCivil(cycles, count, batch) ;
+	}
+
+static void SweepDates(unsigned ovhd)
+	{
+	// Every date through every entry of functions[], checked against a
+	// weekday that just steps along one day at a time, so the reference
+	// shares no arithmetic with any of them. Progress shows once a century.
+	uint32_t params[4], results[2] ;
+	unsigned which, cycles, reference, bin, date ;
+	int year, mnth, k ;
+	char text[100] ;
+
+	SetFontSize(&FONT_CYC) ;
+	SetForeground(COLOR_BLACK) ;
+	SetBackground(COLOR_WHITE) ;
+
+	reference = SWEEP_WEEKDAY ;
+	for (year = SWEEP_FIRST; year <= SWEEP_LAST; year++)
+		{
+		if (year % 100 == 0)
+			{
+			sprintf(text, "Sweeping %d of %d", year, SWEEP_LAST) ;
+			DisplayStringAt(CYCLES_XPOS, SWEEP_YPOS, text) ;
+			}
+
+		for (mnth = 1; mnth <= 12; mnth++)
+			{
+			params[1] = Z_M(mnth) ;
+			params[2] = Z_D(mnth, year) ;
+			params[3] = Z_C(mnth, year) ;
+			for (k = 1; k <= DaysInMonth(mnth, year); k++)
+				{
+				params[0] = Z_K(k) ;
+				date = CIVIL(year, mnth, k) ;
+				for (which = 0; which < ENTRIES(functions); which++)
+					{
+					cycles = CountCycles(functions[which], params, params, results) - ovhd ;
+					bin = (cycles < SWEEP_CYCLES) ? cycles : SWEEP_CYCLES - 1 ;
+					sweep[which].histogram[bin]++ ;
+					sweep[which].calls++ ;
+					sweep[which].total += cycles ;
+					if (cycles > sweep[which].worst)
+						{
+						sweep[which].worst = cycles ;
+						sweep[which].worst_date = date ;
+						}
+					if (results[0] != reference && sweep[which].wrong++ == 0)
+						sweep[which].first_wrong = date ;
+					}
+				reference = (reference + 1) % ENTRIES(weekday) ;
+				}
+			}
+		}
+	}
+
+static unsigned LoadYear(uint32_t dates[], int year)
+	{
+	unsigned count = 0 ;
+	int mnth, date ;
+
+	for (mnth = 1; mnth <= 12; mnth++)
+		{
+		for (date = 1; date <= DaysInMonth(mnth, year); date++)
+			{
+			dates[count++] = Z_PACK(Z_K(date), Z_M(mnth), Z_D(mnth, year), Z_C(mnth, year)) ;
+			}
+		}
+	return count ;
 	}
 
 static void InitializeDate(void)
@@ -241,6 +464,87 @@ static void DisplayCycles(unsigned which, unsigned cycles)
 	DisplayStringAt(CYCLES_XPOS, CYCLES_YPOS(which), text) ;
 	}
 
+static void DisplayBatch(unsigned dates, unsigned cycles)
+	{
+	char text[100] ;
+
+	SetFontSize(&FONT_CYC) ;
+	SetForeground(COLOR_BLACK) ;
+	SetBackground(COLOR_WHITE) ;
+	sprintf(text, "ZellerBatch: %.1f cyc/date", cycles / (float) dates) ;
+	DisplayStringAt(CYCLES_XPOS, CYCLES_YPOS(ENTRIES(functions)), text) ;
+	}
+
+static void DisplayCivil(unsigned cycles[], unsigned dates, unsigned batch[])
+	{
+	char text[100] ;
+
+	SetFontSize(&FONT_CYC) ;
+	SetForeground(COLOR_BLACK) ;
+	SetBackground(COLOR_WHITE) ;
+	sprintf(text, "Civil: %u+%u cyc, batch %.0f+%.0f", cycles[0], cycles[1],
+		batch[0] / (float) dates, batch[1] / (float) dates) ;
+	DisplayStringAt(CYCLES_XPOS, CYCLES_YPOS(ENTRIES(functions) + 1), text) ;
+	}
+
+static void DisplaySweep(void)
+	{
+	char text[100], *next ;
+	unsigned which, bin, shown, date ;
+	int ypos ;
+
+	ClearDisplay() ;
+	SetFontSize(&FONT_CYC) ;
+	SetForeground(COLOR_BLACK) ;
+	SetBackground(COLOR_WHITE) ;
+
+	ypos = SWEEP_YPOS ;
+	for (which = 0; which < ENTRIES(functions); which++)
+		{
+		sprintf(text, "%s: avg %.2f, max %u cyc", functname[which],
+			sweep[which].total / (float) sweep[which].calls, sweep[which].worst) ;
+		DisplayStringAt(CYCLES_XPOS, ypos, text) ;
+		ypos += FONT_CYC.Height ;
+
+		date = sweep[which].worst_date ;
+		sprintf(text, "  slowest %u/%u/%u", (date >> 8) & 0xFF, date & 0xFF, date >> 16) ;
+		DisplayStringAt(CYCLES_XPOS, ypos, text) ;
+		ypos += FONT_CYC.Height ;
+
+		if (sweep[which].wrong != 0)
+			{
+			date = sweep[which].first_wrong ;
+			sprintf(text, "  %u WRONG from %u/%u/%u", sweep[which].wrong,
+				(date >> 8) & 0xFF, date & 0xFF, date >> 16) ;
+			DisplayStringAt(CYCLES_XPOS, ypos, text) ;
+			ypos += FONT_CYC.Height ;
+			LEDs(0, 1) ;
+			}
+
+		// Percent of calls at each cycle count seen
+		shown = 0 ;
+		next = text ;
+		for (bin = 0; bin < SWEEP_CYCLES; bin++)
+			{
+			if (sweep[which].histogram[bin] == 0) continue ;
+			next += sprintf(next, "%s%2u%s:%4.1f%%", (shown % SWEEP_PER_LINE) ? " " : "  ",
+				bin, (bin == SWEEP_CYCLES - 1) ? "+" : "",
+				100.0 * sweep[which].histogram[bin] / sweep[which].calls) ;
+			if (++shown % SWEEP_PER_LINE != 0) continue ;
+			DisplayStringAt(CYCLES_XPOS, ypos, text) ;
+			ypos += FONT_CYC.Height ;
+			next = text ;
+			}
+		if (shown % SWEEP_PER_LINE != 0)
+			{
+			DisplayStringAt(CYCLES_XPOS, ypos, text) ;
+			ypos += FONT_CYC.Height ;
+			}
+
+		ypos += FONT_CYC.Height / 2 ;
+		}
+	}
+
 static void Error(char *functname, char *format, ...)
 	{
 	uint32_t width, row, col, chars ;
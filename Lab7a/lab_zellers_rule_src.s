@@ -81,9 +81,9 @@ Zeller2:    //R0 = k, R1 = m, R2 = D, R3 = C
         SMMUL R4,R0,R1          //R4 <-- MS half of Double Length Multiply
         LDR R3,=7               
         MLS R0,R4,R3,R0         //R0 <-- f - 7 * (f / 7)
-        CMP R0,0                //Check to see if the remainder is less than zero (r < 0)
-        IT  LT             
-        ADDLT R0,R0,7           //If it is than Add 7 ( r += 7) 
+        CMP R0,7                //SMMUL rounds f / 7 down, so r is never negative,
+        IT  EQ                  //but a negative multiple of 7 leaves r = 7
+        MOVEQ R0,0
         POP {R4-R6}
         BX LR
 
@@ -127,4 +127,48 @@ Zeller3:
         ADDLT R0,R0,7       //If it is than Add 7 ( r += 7)
         POP {R4-R6}
         BX LR
+
+// ----------------------------------------------------------
+// uint32_t Zeller4(uint32_t k, uint32_t m, uint32_t D, uint32_t C);
+//
+//  Description:
+//  Same sum as Zeller1-3, but each term comes out of a table in flash,
+//  already reduced mod 7, so there is no multiply or divide at all.
+//  The terms add up to at most 31 + 3*6 = 49, and one more table
+//  takes that sum mod 7. D must be 99 or less.
+// ----------------------------------------------------------
+
+    .global Zeller4
+    .thumb_func
+    .align
+
+Zeller4:    //R0 = k, R1 = m, R2 = D, R3 = C
+        ADR R12,MonthTerm
+        LDRB R1,[R12,R1]        //R1 <-- ((13m - 1) / 5) mod 7
+        ADD R0,R0,R1            //R0 <-- k + month term
+        ADR R12,YearTerm
+        LDRB R2,[R12,R2]        //R2 <-- (D + D / 4) mod 7
+        ADD R0,R0,R2            //R0 <-- f + year term
+        AND R3,R3,3             //R3 <-- C mod 4
+        ADR R12,CenturyTerm
+        LDRB R3,[R12,R3]        //R3 <-- (C / 4 - 2C) mod 7, never negative
+        ADD R0,R0,R3            //R0 <-- f + century term, 1 to 49
+        ADR R12,Mod7
+        LDRB R0,[R12,R0]        //R0 <-- f mod 7
+        BX LR
+
+MonthTerm:      //m = 0 (unused) to 12
+        .byte 0,2,5,0,3,5,1,4,6,2,4,0,3
+YearTerm:       //D = 0 to 99
+        .byte 0,1,2,3,5,6,0,1,3,4,5,6,1,2,3,4,6,0,1,2
+        .byte 4,5,6,0,2,3,4,5,0,1,2,3,5,6,0,1,3,4,5,6
+        .byte 1,2,3,4,6,0,1,2,4,5,6,0,2,3,4,5,0,1,2,3
+        .byte 5,6,0,1,3,4,5,6,1,2,3,4,6,0,1,2,4,5,6,0
+        .byte 2,3,4,5,0,1,2,3,5,6,0,1,3,4,5,6,1,2,3,4
+CenturyTerm:    //C mod 4 = 0 to 3, as the calendar repeats every 400 years
+        .byte 0,5,3,1
+Mod7:           //f = 0 to 49
+        .byte 0,1,2,3,4,5,6,0,1,2,3,4,5,6,0,1,2,3,4,5,6,0,1,2,3
+        .byte 4,5,6,0,1,2,3,4,5,6,0,1,2,3,4,5,6,0,1,2,3,4,5,6,0
+
         .end